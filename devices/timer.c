@@ -21,9 +21,28 @@
 
 // static struct semaphore *sleep; // sleep 타이머용 세마포어.
 
+/* 8254 input frequency, and its count for one timer tick,
+   rounded to nearest. */
+#define PIT_HZ 1193180
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Longest one-shot the 16-bit counter can time, in ticks. */
+#define ONESHOT_MAX_TICKS (0xffff / PIT_TICK_COUNT)
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* If true, the idle thread reprograms the timer as a one-shot
+   for the next deadline instead of taking every periodic tick.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* One-shot armed by timer_idle_enter(), if any: the number of
+   ticks it spans and its initial count. */
+static bool oneshot_armed;
+static int64_t oneshot_ticks;
+static uint16_t oneshot_count;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -32,22 +51,92 @@ static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
+static void pit_set_periodic (void);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
    corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	pit_set_periodic ();
+	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+
+}
+
+/* Programs PIT counter 0 to interrupt TIMER_FREQ times per
+   second. */
+static void
+pit_set_periodic (void) {
+	uint16_t count = PIT_TICK_COUNT;
 
 	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
 	outb (0x40, count & 0xff);
 	outb (0x40, count >> 8);
+}
 
-	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  In tickless mode, replaces the periodic tick by a
+   single interrupt at the next sleep deadline or, under the
+   MLFQS, the next whole second, whichever is sooner.  The 16-bit
+   counter limits this to ONESHOT_MAX_TICKS at a time. */
+void
+timer_idle_enter (void) {
+	int64_t deadline, span;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (!timer_tickless || oneshot_armed)
+		return;
+
+	deadline = thread_next_wakeup ();
+	if (thread_mlfqs) {
+		int64_t second = (ticks / TIMER_FREQ + 1) * TIMER_FREQ;
+		if (second < deadline)
+			deadline = second;
+	}
+	span = deadline - ticks;
+	if (span > ONESHOT_MAX_TICKS)
+		span = ONESHOT_MAX_TICKS;
+	if (span <= 1)
+		return;
+
+	oneshot_armed = true;
+	oneshot_ticks = span;
+	oneshot_count = span * PIT_TICK_COUNT;
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, oneshot_count & 0xff);
+	outb (0x40, oneshot_count >> 8);
+}
 
+/* Called with interrupts off when the idle thread is switched
+   out.  If a one-shot armed by timer_idle_enter() has not fired
+   yet, charges the ticks that have passed so far and goes back to
+   the periodic tick. */
+void
+timer_idle_exit (void) {
+	uint8_t status;
+	uint16_t remaining;
+	int64_t elapsed;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (!oneshot_armed)
+		return;
+
+	/* Read-back: latch status and count of counter 0. */
+	outb (0x43, 0xc2);
+	status = inb (0x40);
+	remaining = inb (0x40);
+	remaining |= inb (0x40) << 8;
+
+	/* If OUT is high, it fired and its interrupt is still pending,
+	   so leave the last tick for timer_interrupt(). */
+	if (status & 0x80)
+		elapsed = oneshot_ticks - 1;
+	else
+		elapsed = (oneshot_count - remaining) / PIT_TICK_COUNT;
+	oneshot_armed = false;
+	pit_set_periodic ();
+	ticks += elapsed;
+	thread_idle_ticks (elapsed);
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -129,6 +218,13 @@ timer_print_stats (void) {
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
+	if (oneshot_armed) {
+		/* The one-shot covered ONESHOT_TICKS ticks of idle time. */
+		oneshot_armed = false;
+		ticks += oneshot_ticks - 1;
+		thread_idle_ticks (oneshot_ticks - 1);
+		pit_set_periodic ();
+	}
 	ticks++;
 	thread_tick ();
 
@@ -92,6 +92,65 @@ struct hash_elem *hash_cur (struct hash_iterator *);
 size_t hash_size (struct hash *);
 bool hash_empty (struct hash *);
 
+/* Open-addressing hash table.
+ *
+ * Holds the same struct hash_elem's and takes the same hash and
+ * less functions as struct hash, with the same contract for each
+ * operation, but stores pointers to the elements in a single
+ * array of slots instead of chaining them into lists.  A lookup
+ * usually touches one or two adjacent slots and then the element
+ * itself.  Collisions are resolved by linear probing with Robin
+ * Hood ordering, and each slot caches its element's hash value
+ * so that most mismatches are rejected without calling LESS.
+ *
+ * When the table grows, the old array is kept and its elements
+ * are moved over a few slots at a time by later insertions and
+ * deletions, so no single operation pays for a full rehash.
+ * Lookups check both arrays meanwhile.  An element must not be
+ * in a struct hash and a struct ohash at the same time. */
+
+/* Slot in an open-addressing hash table. */
+struct ohash_slot {
+	struct hash_elem *elem;     /* Element, or a null pointer if empty. */
+	uint64_t hash;              /* Hash value of ELEM. */
+};
+
+/* Open-addressing hash table. */
+struct ohash {
+	size_t elem_cnt;            /* Number of elements in table. */
+	size_t slot_cnt;            /* Number of slots, a power of 2. */
+	struct ohash_slot *slots;   /* Array of `slot_cnt' slots. */
+	size_t old_slot_cnt;        /* Number of slots in OLD_SLOTS, or 0. */
+	struct ohash_slot *old_slots; /* Array being moved into SLOTS. */
+	size_t old_elem_cnt;        /* Elements still in OLD_SLOTS. */
+	size_t old_pos;             /* OLD_SLOTS below this index are empty. */
+	hash_hash_func *hash;       /* Hash function. */
+	hash_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `hash' and `less'. */
+};
+
+/* An open-addressing hash table iterator. */
+struct ohash_iterator {
+	struct ohash *hash;         /* The hash table. */
+	size_t pos;                 /* Next slot to examine. */
+	struct hash_elem *elem;     /* Current hash element. */
+};
+
+bool ohash_init (struct ohash *, hash_hash_func *, hash_less_func *,
+		void *aux);
+void ohash_clear (struct ohash *, hash_action_func *);
+void ohash_destroy (struct ohash *, hash_action_func *);
+struct hash_elem *ohash_insert (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_replace (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_find (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_delete (struct ohash *, struct hash_elem *);
+void ohash_apply (struct ohash *, hash_action_func *);
+void ohash_first (struct ohash_iterator *, struct ohash *);
+struct hash_elem *ohash_next (struct ohash_iterator *);
+struct hash_elem *ohash_cur (struct ohash_iterator *);
+size_t ohash_size (struct ohash *);
+bool ohash_empty (struct ohash *);
+
 /* Sample hash functions. */
 uint64_t hash_bytes (const void *, size_t);
 uint64_t hash_string (const char *);
@@ -0,0 +1,21 @@
+#ifndef __LIB_SCHEDSTAT_H
+#define __LIB_SCHEDSTAT_H
+
+#include <stdint.h>
+
+/* Scheduler latency counters, kept both per thread and for the
+   whole system.  Times are in TSC cycles.  Shared between the
+   kernel and user programs through the schedstat() system call. */
+struct sched_stats {
+	uint64_t ctx_switches;          /* # of times switched to. */
+	uint64_t switch_cycles;         /* Time spent in context switches. */
+	uint64_t rq_wait_cycles;        /* Time spent READY in a run queue. */
+	uint64_t rq_wait_max;           /* Longest single run queue wait. */
+	uint64_t lock_contended;        /* # of lock_acquire()s that waited. */
+	uint64_t lock_wait_cycles;      /* Time spent waiting for locks. */
+	uint64_t donation_depth_max;    /* Deepest priority donation chain. */
+	uint64_t intr_off_cycles;       /* Time with interrupts disabled. */
+	uint64_t intr_off_max;          /* Longest interrupts-off section. */
+};
+
+#endif /* lib/schedstat.h */
@@ -36,6 +36,12 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Instrumentation. */
+	SYS_SCHEDSTAT,              /* Read scheduler latency counters. */
+
+	/* Resource control. */
+	SYS_MEMQUOTA,               /* Set user page quota. */
 };
 
 #endif /* lib/syscall-nr.h */
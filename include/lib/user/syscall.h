@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <schedstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -50,6 +51,12 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Instrumentation. */
+int schedstat (struct sched_stats *thread, struct sched_stats *global);
+
+/* Resource control. */
+int memquota (size_t limit, size_t reserve);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -0,0 +1,34 @@
+#ifndef THREADS_BUDDY_H
+#define THREADS_BUDDY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Binary buddy allocator over a range of PAGE_CNT pages,
+   identified by index.  See buddy.c for details. */
+
+/* Number of block sizes: 1, 2, 4, ..., 2**(BUDDY_ORDERS - 1)
+   pages. */
+#define BUDDY_ORDERS 24
+
+/* Returned by buddy_alloc() on failure. */
+#define BUDDY_ERROR SIZE_MAX
+
+struct buddy_page;
+
+struct buddy {
+	size_t page_cnt;                    /* Number of pages managed. */
+	size_t free_cnt;                    /* Number of free pages. */
+	struct buddy_page *pages;           /* Per-page bookkeeping. */
+	uint32_t heads[BUDDY_ORDERS];       /* First free block of each order. */
+	uint32_t nonempty;                  /* Bit K set iff heads[K] is in use. */
+};
+
+size_t buddy_meta_size (size_t page_cnt);
+void buddy_init (struct buddy *, size_t page_cnt, void *meta);
+size_t buddy_alloc (struct buddy *, size_t page_cnt);
+void buddy_free (struct buddy *, size_t page_idx, size_t page_cnt);
+void buddy_claim (struct buddy *, size_t page_idx, size_t page_cnt);
+size_t buddy_free_cnt (const struct buddy *);
+
+#endif /* threads/buddy.h */
@@ -14,6 +14,7 @@ enum intr_level intr_get_level (void);
 enum intr_level intr_set_level (enum intr_level);
 enum intr_level intr_enable (void);
 enum intr_level intr_disable (void);
+void intr_off_end (void);
 
 /* Interrupt stack frame. */
 struct gp_registers {
@@ -4,10 +4,22 @@
 #include <debug.h>
 #include <stddef.h>
 
+/* Number of small-block size classes (16 to 1024 bytes). */
+#define MALLOC_CLASS_CNT 7
+
+/* Per-thread magazine of free blocks of one size class. */
+struct malloc_mag {
+	void *head;                 /* First block, linked through blocks. */
+	unsigned cnt;               /* Number of blocks. */
+};
+
 void malloc_init (void);
+void malloc_thread_exit (void);
+void malloc_print_stats (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
+size_t malloc_usable_size (void *);
 void free (void *);
 
 #endif /* threads/malloc.h */
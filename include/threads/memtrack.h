@@ -0,0 +1,37 @@
+#ifndef THREADS_MEMTRACK_H
+#define THREADS_MEMTRACK_H
+
+#include <debug.h>
+#include <stddef.h>
+
+/* Kernel memory accounting, enabled by building with
+   "make MEMTRACK=N".  Every palloc, malloc and slab allocation is
+   charged to the address it was called from, or with N > 1,
+   one in N allocations is.  See memtrack.c. */
+
+/* What an allocation came from. */
+enum memtrack_kind {
+	MEMTRACK_PALLOC,            /* palloc_get_page/multiple(). */
+	MEMTRACK_MALLOC,            /* malloc(), calloc(), realloc(). */
+	MEMTRACK_SLAB,              /* kmem_cache_alloc/zalloc(). */
+};
+
+/* Call site to charge, from inside an allocator's entry point. */
+#define MEMTRACK_SITE __builtin_return_address (0)
+
+#ifdef MEMTRACK
+void memtrack_init (void);
+void memtrack_alloc (enum memtrack_kind, const void *site, void *, size_t);
+void memtrack_resize (void *, size_t);
+void memtrack_free (void *);
+void memtrack_dump (void);
+#else
+static inline void memtrack_init (void) {}
+static inline void memtrack_alloc (enum memtrack_kind kind UNUSED,
+		const void *site UNUSED, void *p UNUSED, size_t size UNUSED) {}
+static inline void memtrack_resize (void *p UNUSED, size_t size UNUSED) {}
+static inline void memtrack_free (void *p UNUSED) {}
+static inline void memtrack_dump (void) {}
+#endif
+
+#endif /* threads/memtrack.h */
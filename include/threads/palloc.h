@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -14,10 +15,37 @@ enum palloc_flags {
 /* Maximum number of pages to put in user pool. */
 extern size_t user_page_limit;
 
+/* Default per-process limit on user pool pages. */
+extern size_t user_page_quota;
+
+/* Most user pool pages all processes together may reserve. */
+extern size_t user_reserve_max;
+
+/* A process's share of the user pool. */
+struct user_quota {
+	size_t used;                /* User pages held. */
+	size_t limit;               /* Most user pages it may hold. */
+	size_t reserve;             /* Pages set aside for it. */
+};
+
+/* Use the buddy allocator instead of bitmap scans. */
+extern bool palloc_buddy;
+
 uint64_t palloc_init (void);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
+bool palloc_extend (void *pages, size_t page_cnt, size_t new_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+bool palloc_set_quota (size_t limit, size_t reserve);
+bool palloc_zero_idle (void);
+void page_zero (void *page);
+void page_copy (void *dst, const void *src);
+bool palloc_over_quota (void);
+bool palloc_share_page (void *page);
+size_t palloc_page_holders (void *page);
+void palloc_take_charge (struct user_quota *from);
+void palloc_drop_share (void *page, struct user_quota *from);
+bool palloc_within_reserve (const struct user_quota *);
 
 #endif /* threads/palloc.h */
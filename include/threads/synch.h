@@ -2,7 +2,9 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <heap.h>
 #include <stdbool.h>
+#include "threads/interrupt.h"
 
 /* A counting semaphore. */
 struct semaphore {
@@ -20,6 +22,8 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct heap donors;         /* Waiting threads, by priority. */
+	struct heap_elem elem;      /* Element in holder's held_locks. */
 };
 
 void lock_init (struct lock *);
@@ -27,6 +31,66 @@ void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+int lock_donated_priority (struct lock *);
+bool lock_priority_less (const struct heap_elem *, const struct heap_elem *,
+                         void *aux);
+
+/* Adaptive mutex.
+
+   A lighter alternative to struct lock for short critical
+   sections.  Acquiring a free mutex or releasing one nobody waits
+   on is a single atomic operation that neither disables
+   interrupts nor touches the waiter list.  A contended acquire
+   spins while the holder is running on another CPU and yields
+   while the holder is ready to run at our priority or higher,
+   and only blocks when neither helps.
+
+   Mutexes take no part in priority donation, so use struct lock
+   for anything held across long or user-visible waits. */
+struct mutex {
+	volatile int state;         /* 0: free, 1: held, 2: held and contended. */
+	struct thread *holder;      /* Thread holding mutex. */
+	struct list waiters;        /* List of blocked threads. */
+};
+
+void mutex_init (struct mutex *);
+void mutex_acquire (struct mutex *);
+bool mutex_try_acquire (struct mutex *);
+void mutex_release (struct mutex *);
+bool mutex_held_by_current_thread (const struct mutex *);
+
+/* Reader-writer lock.
+
+   Any number of readers may hold the lock at once, or a single
+   writer.  Writers take preference: once a writer is waiting, new
+   readers queue behind it.  Every waiting thread donates its
+   priority to all current holders, so a high-priority writer
+   boosts the readers it waits for. */
+struct rwlock {
+	int readers;                /* Active readers, or -1 if write-held. */
+	struct list holders;        /* rw_hold of each reader or the writer. */
+	struct list read_waiters;   /* Blocked readers. */
+	struct list write_waiters;  /* Blocked writers. */
+	struct heap donors;         /* All blocked threads, by priority. */
+};
+
+/* One thread's hold on an rwlock.  Allocated when the rwlock is
+   acquired and freed when it is released, so a thread may hold
+   any number of rwlocks. */
+struct rw_hold {
+	struct rwlock *rw;          /* Held rwlock. */
+	struct thread *thread;      /* Holding thread. */
+	struct list_elem elem;      /* Element in rw->holders. */
+	struct list_elem thread_elem; /* Element in thread's rw_holds. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+int rwlock_donated_priority (struct rwlock *);
 
 /* Condition variable. */
 struct condition {
@@ -41,6 +105,18 @@ void cond_broadcast (struct condition *, struct lock *);
 
 bool semaphore_priority_less(const struct list_elem *a,const struct list_elem *b,void *aux);
 
+/* Spinlock, for short critical sections that may be entered
+   from an interrupt handler.  Holding one also keeps interrupts
+   off, but the holder must never sleep. */
+struct spinlock {
+	volatile int locked;        /* 1 if held. */
+	enum intr_level old_level;  /* Interrupt level before acquire. */
+};
+
+void spin_lock_init (struct spinlock *);
+void spin_lock (struct spinlock *);
+void spin_unlock (struct spinlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
@@ -3,10 +3,14 @@
 
 #include <debug.h>
 #include <list.h>
+#include <heap.h>
 #include <stdint.h>
+#include <schedstat.h>
 #include "threads/interrupt.h"
 #include "filesys/file.h"
 #include "threads/synch.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -29,6 +33,9 @@ typedef int tid_t;
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Usable pages in a kernel stack, not counting its guard page. */
+#define KSTACK_PAGES 2
+
 /* Thread priorities. */
 #define PRI_MIN 0                       /* Lowest priority. */
 #define PRI_DEFAULT 31                  /* Default priority. */
@@ -36,55 +43,48 @@ typedef int pid_t;
 
 /* A kernel thread or user process.
  *
- * Each thread structure is stored in its own 4 kB page.  The
- * thread structure itself sits at the very bottom of the page
- * (at offset 0).  The rest of the page is reserved for the
- * thread's kernel stack, which grows downward from the top of
- * the page (at offset 4 kB).  Here's an illustration:
+ * Each thread structure is stored in its own 4 kB page, and its
+ * kernel stack lives in a separate KSTACK_PAGES-page region just
+ * above an unmapped guard page.  Here's an illustration:
  *
- *      4 kB +---------------------------------+
+ *           +---------------------------------+ <- kstack_top
  *           |          kernel stack           |
  *           |                |                |
- *           |                |                |
  *           |                V                |
  *           |         grows downward          |
  *           |                                 |
- *           |                                 |
- *           |                                 |
- *           |                                 |
- *           |                                 |
- *           |                                 |
- *           |                                 |
- *           |                                 |
  *           +---------------------------------+
+ *           |     guard page (not mapped)     |
+ *           +---------------------------------+ <- kstack
+ *
+ *      4 kB +---------------------------------+
  *           |              magic              |
  *           |            intr_frame           |
  *           |                :                |
- *           |                :                |
  *           |               name              |
  *           |              status             |
- *      0 kB +---------------------------------+
+ *      0 kB +---------------------------------+ <- struct thread
+ *
+ * The running thread is found through the per-CPU state, not by
+ * rounding down the stack pointer.  The exception is the initial
+ * thread, which keeps running on the stack the loader set up in
+ * its own page and has no separate kernel stack.
  *
  * The upshot of this is twofold:
  *
- *    1. First, `struct thread' must not be allowed to grow too
- *       big.  If it does, then there will not be enough room for
- *       the kernel stack.  Our base `struct thread' is only a
- *       few bytes in size.  It probably should stay well under 1
- *       kB.
+ *    1. First, `struct thread' must still fit in a page.
  *
  *    2. Second, kernel stacks must not be allowed to grow too
- *       large.  If a stack overflows, it will corrupt the thread
- *       state.  Thus, kernel functions should not allocate large
- *       structures or arrays as non-static local variables.  Use
- *       dynamic allocation with malloc() or palloc_get_page()
- *       instead.
+ *       large.  A stack that runs off its bottom hits the guard
+ *       page, which faults at once instead of silently
+ *       corrupting whatever lies below.  Kernel functions should
+ *       still not allocate large structures or arrays as
+ *       non-static local variables.  Use dynamic allocation with
+ *       malloc() or palloc_get_page() instead.
  *
- * The first symptom of either of these problems will probably be
- * an assertion failure in thread_current(), which checks that
- * the `magic' member of the running thread's `struct thread' is
- * set to THREAD_MAGIC.  Stack overflow will normally change this
- * value, triggering the assertion. */
+ * Since the CPU has to push the page-fault frame onto the
+ * overflowed stack, a guard page hit currently ends in a triple
+ * fault rather than a panic message. */
 /* The `elem' member has a dual purpose.  It can be an element in
  * the run queue (thread.c), or it can be an element in a
  * semaphore wait list (synch.c).  It can be used these two ways
@@ -101,19 +101,24 @@ struct thread {
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
+	uint64_t ready_since;               /* TSC when put on a run queue. */
+	struct sched_stats stats;           /* Scheduler latency counters. */
 
 	// 쓰레드 tick. sleep 함수 용.
 	int64_t ticks;
 
 	//Donation용
 	struct lock *wait_on_lock; // 현재 기다리는 lock 포인터
-	struct list donation; // 현재 이 스레드가 받는 기부리스트가 있을 경우.
-	struct list_elem d_elem;
+	struct heap held_locks; // 가지고 있는 lock들. 각 lock이 받는 최대 기부 priority 순.
+	struct heap_elem donor_elem; // wait_on_lock->donors 또는 wait_on_rw->donors 원소.
+	struct rwlock *wait_on_rw; // 현재 기다리는 rwlock 포인터
+	struct list rw_holds; // 가지고 있는 rwlock들의 rw_hold 목록.
 	int init_pri; //맨처음에 선언된 priority
 
 	//mlfqs용
 	int recent_cpu;
 	int nice;
+	unsigned decay_epoch; // recent_cpu에 마지막으로 적용된 decay 번호
 	struct list_elem all_elem;
 	// ------------------------
 	// userprog용 exit status
@@ -133,6 +138,7 @@ struct thread {
 
 	struct intr_frame parent_if;
 	struct file *running;
+	char *exec_page; // exec()가 복사한 명령줄 페이지. process_exec가 해제하기 전까지 보관.
 
 	// struct file **f_fdt;
 	// int fd_next;
@@ -150,7 +156,14 @@ struct thread {
 	struct supplemental_page_table spt;
 #endif
 
+	/* Owned by threads/palloc.c. */
+	struct user_quota uquota;           /* User pool pages held and allowed. */
+
+	/* Owned by threads/malloc.c. */
+	struct malloc_mag mags[MALLOC_CLASS_CNT]; /* Free block magazines. */
+
 	/* Owned by thread.c. */
+	uint8_t *kstack;                    /* Kernel stack region, or null. */
 	struct intr_frame tf;               /* Information for switching */
 	unsigned magic;                     /* Detects stack overflow. */
 };
@@ -164,7 +177,14 @@ void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_idle_ticks (int64_t n);
+int64_t thread_next_wakeup (void);
 void thread_print_stats (void);
+void thread_print_sched_stats (void);
+void thread_get_sched_stats (struct sched_stats *thread,
+		struct sched_stats *global);
+void thread_account_intr_off (uint64_t cycles);
+void thread_account_lock_wait (uint64_t cycles);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -173,6 +193,7 @@ void thread_block (void);
 void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
+void *thread_stack_top (struct thread *);
 tid_t thread_tid (void);
 const char *thread_name (void);
 
@@ -193,7 +214,7 @@ void thread_wake_up(int64_t ticks);
 void thread_sleep(int64_t tick); 
 
 bool thread_priority_less(const struct list_elem *a, const struct list_elem *b, void *aux);
-bool donation_priority_less(const struct list_elem *a, const struct list_elem *b, void *aux);
+bool donor_priority_less(const struct heap_elem *a, const struct heap_elem *b, void *aux);
 bool thread_donation_priority_less(const struct list_elem *a, const struct list_elem *b, void *aux);
 void donate_priority(void);
 void donate_set_priority(struct thread *new);
@@ -206,6 +227,7 @@ void calculating_therad_priority(struct thread *t);
 
 void set_thread_priority(void);
 int max_priority(void);
+void thread_change_priority (struct thread *t, int priority);
 void increment_recent_cpu(void);
 
 struct thread* get_child_process(int pid);
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <schedstat.h>
 #include <threads/synch.h>
 #include "threads/interrupt.h"
 
@@ -45,6 +46,7 @@ void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
 void check_address(const uint64_t *addr);
+void check_address_string(const void *buffer, unsigned size);
 
 
 
@@ -53,5 +55,7 @@ struct file* get_file_fd(int fd);
 pid_t ffork (const char *thread_name, struct intr_frame *f);
 
 int dup2(int oldfd, int newfd);
+int schedstat (struct sched_stats *thread, struct sched_stats *global);
+int memquota (size_t limit, size_t reserve);
 
 #endif /* userprog/syscall.h */
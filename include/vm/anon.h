@@ -1,13 +1,22 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
+#include <stddef.h>
 #include "vm/vm.h"
 struct page;
 enum vm_type;
 
+/* Most pages swapped out in one batch. */
+#define SWAP_BATCH 8
+
 struct anon_page {
+	size_t slot;            /* Swap slot, or BITMAP_ERROR if none. */
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_swap_out_batch (struct page *pages[], size_t cnt);
+void anon_swap_share (struct page *page, struct page *src);
+bool anon_swap_copy (struct page *page, void *kva);
+void vm_anon_print_stats (void);
 
 #endif
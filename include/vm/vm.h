@@ -1,6 +1,9 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
 #include "threads/palloc.h"
 
 enum vm_type {
@@ -24,6 +27,10 @@ enum vm_type {
 	VM_MARKER_END = (1 << 31),
 };
 
+/* Marks a lazily loaded page whose contents come from a file, so
+ * that the fault handler reads the pages after it ahead of need. */
+#define VM_FILE_CONTENTS VM_MARKER_0
+
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
@@ -46,6 +53,10 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
+	bool writable;         /* Mapped read/write? */
+	struct thread *owner;  /* Process whose SPT holds the page. */
+	struct hash_elem elem; /* Element in the SPT's page index. */
+	struct list_elem share_elem; /* Element in the frame's sharers. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -59,10 +70,19 @@ struct page {
 	};
 };
 
-/* The representation of "frame" */
+/* The representation of "frame"
+ *
+ * After fork(), the parent's and the child's pages may share one
+ * frame, mapped read-only in both page tables until one of them
+ * writes to it.  PAGE is the page that eviction swaps out, and
+ * SHARERS are the others, which take the same swap slot. */
 struct frame {
 	void *kva;
 	struct page *page;
+	struct list sharers;        /* Other pages mapping the frame. */
+	unsigned holders;           /* Pages mapping the frame, PAGE included. */
+	unsigned pin_cnt;           /* If nonzero, not to be evicted. */
+	struct list_elem elem;      /* Element in the frame table. */
 };
 
 /* The function table for page operations.
@@ -81,21 +101,49 @@ struct page_operations {
 #define destroy(page) \
 	if ((page)->operations->destroy) (page)->operations->destroy (page)
 
+/* A region of a process's address space: the code or data of its
+ * executable, its stack, or a mapped file.  Its pages get a struct
+ * page only when they are first used. */
+struct vm_area {
+	uint8_t *start;        /* First page. */
+	uint8_t *end;          /* Page past the last. */
+	enum vm_type type;     /* Type of its pages. */
+	bool writable;         /* Mapped read/write? */
+	struct file *file;     /* Contents, or NULL if zero-filled. */
+	off_t ofs;             /* Offset in FILE of START. */
+	size_t read_bytes;     /* Bytes read from FILE; the rest are zeroed. */
+};
+
 /* Representation of current process's memory space.
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
 struct supplemental_page_table {
+	struct ohash pages;    /* Pages in use, by address. */
+	struct vm_area **areas; /* Areas, sorted by address. */
+	size_t area_cnt;       /* Number of areas. */
+	size_t area_cap;       /* Capacity of AREAS. */
+	void *ra_next;         /* Page a sequential reader faults on next. */
+	size_t ra_window;      /* Pages to read ahead of the next fault. */
 };
 
 #include "threads/thread.h"
-void supplemental_page_table_init (struct supplemental_page_table *spt);
+bool supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
 		struct supplemental_page_table *src);
 void supplemental_page_table_kill (struct supplemental_page_table *spt);
 struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
+struct page *spt_get_page (struct supplemental_page_table *spt, void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+bool vm_area_map (struct supplemental_page_table *spt, void *start,
+		size_t size, bool writable, enum vm_type type, struct file *file,
+		off_t ofs, size_t read_bytes);
+void vm_area_unmap (struct supplemental_page_table *spt, void *start);
+struct vm_area *vm_area_find (struct supplemental_page_table *spt,
+		const void *va);
+bool vm_area_overlaps (struct supplemental_page_table *spt,
+		const void *start, size_t size);
 
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
@@ -107,6 +155,8 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+bool vm_pin_buffer (const void *buffer, size_t size, bool write);
+void vm_unpin_buffer (const void *buffer, size_t size);
 enum vm_type page_get_type (struct page *page);
 
 #endif  /* VM_VM_H */
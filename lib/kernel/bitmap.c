@@ -63,6 +63,47 @@ last_mask (const struct bitmap *b) {
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns an elem_type in which the CNT bits starting at bit
+   OFS are set to 1 and the rest are set to 0.  OFS + CNT must
+   not exceed ELEM_BITS, and CNT must be nonzero. */
+static inline elem_type
+range_mask (size_t ofs, size_t cnt) {
+	return ((elem_type) -1 >> (ELEM_BITS - cnt)) << ofs;
+}
+
+/* Returns the number of bits set to 1 in X. */
+static inline size_t
+count_ones (elem_type x) {
+	x = x - ((x >> 1) & 0x5555555555555555UL);
+	x = (x & 0x3333333333333333UL) + ((x >> 2) & 0x3333333333333333UL);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fUL;
+	return (x * 0x0101010101010101UL) >> 56;
+}
+
+/* Returns the index of the first bit in B between START and
+   END, exclusive, that is set to VALUE, or END if there is none.
+   Skips whole elements that have no such bit. */
+static size_t
+find_bit (const struct bitmap *b, size_t start, size_t end, bool value) {
+	elem_type flip = value ? 0 : (elem_type) -1;
+	size_t last, idx;
+	elem_type x;
+
+	if (start >= end)
+		return end;
+
+	idx = elem_idx (start);
+	last = elem_idx (end - 1);
+	x = (b->bits[idx] ^ flip) & ((elem_type) -1 << (start % ELEM_BITS));
+	while (x == 0) {
+		if (++idx > last)
+			return end;
+		x = b->bits[idx] ^ flip;
+	}
+	start = idx * ELEM_BITS + __builtin_ctzl (x);
+	return start < end ? start : end;
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -203,8 +244,20 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	/* Each element is updated atomically, as by bitmap_set(). */
+	for (i = start; i < start + cnt; ) {
+		size_t ofs = i % ELEM_BITS;
+		size_t n = ELEM_BITS - ofs < start + cnt - i
+			? ELEM_BITS - ofs : start + cnt - i;
+		elem_type mask = range_mask (ofs, n);
+		elem_type *e = &b->bits[elem_idx (i)];
+
+		if (value)
+			asm ("lock orq %1, %0" : "+m" (*e) : "r" (mask) : "cc");
+		else
+			asm ("lock andq %1, %0" : "+m" (*e) : "r" (~mask) : "cc");
+		i += n;
+	}
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -218,26 +271,25 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (start + cnt <= b->bit_cnt);
 
 	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
-	return value_cnt;
+	for (i = start; i < start + cnt; ) {
+		size_t ofs = i % ELEM_BITS;
+		size_t n = ELEM_BITS - ofs < start + cnt - i
+			? ELEM_BITS - ofs : start + cnt - i;
+		value_cnt += count_ones (b->bits[elem_idx (i)] & range_mask (ofs, n));
+		i += n;
+	}
+	return value ? value_cnt : cnt - value_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			return true;
-	return false;
+	return find_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -266,18 +318,35 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Rather than testing each candidate start in turn, we jump to
+   the next bit set to VALUE, then to the next bit after it set
+   to !VALUE.  If that is at least CNT bits away, we have found
+   a group; otherwise the search resumes just past it.  Both
+   jumps skip whole elements at a time, so long runs of either
+   value cost one test per element. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
+	if (cnt == 0)
+		return start;
 	if (cnt <= b->bit_cnt) {
 		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
+		size_t i = start;
+		while (i <= last) {
+			size_t end;
+
+			i = find_bit (b, i, last + 1, value);
+			if (i > last)
+				break;
+			end = find_bit (b, i, i + cnt, !value);
+			if (end == i + cnt)
 				return i;
+			i = end + 1;
+		}
 	}
 	return BITMAP_ERROR;
 }
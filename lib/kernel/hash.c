@@ -392,3 +392,369 @@ remove_elem (struct hash *h, struct hash_elem *e) {
 	list_remove (&e->list_elem);
 }
 
+
+/* Open-addressing hash table.  See hash.h for an overview. */
+
+/* Number of slots in a new table. */
+#define OHASH_MIN_SLOTS 16
+
+/* Number of old slots moved by each insertion or deletion while
+   the table is growing.  Growing doubles the number of slots at
+   3/4 load, so at least 3/8 of the new slots' worth of
+   insertions pass before the next growth; moving 4 slots each
+   time finishes the old table well before then. */
+#define OHASH_MIGRATE_STEP 4
+
+static struct ohash_slot *ohash_lookup (struct ohash *, struct hash_elem *,
+		uint64_t hash, bool *in_old);
+static void ohash_grow (struct ohash *);
+static void ohash_migrate (struct ohash *, size_t slot_cnt);
+static struct ohash_slot *slots_find (struct ohash *, struct ohash_slot *,
+		size_t slot_cnt, struct hash_elem *, uint64_t hash);
+static void slots_insert (struct ohash_slot *, size_t slot_cnt,
+		struct hash_elem *, uint64_t hash);
+static void slots_remove (struct ohash_slot *, size_t slot_cnt,
+		struct ohash_slot *);
+
+/* Initializes hash table H to compute hash values using HASH and
+   compare hash elements using LESS, given auxiliary data AUX. */
+bool
+ohash_init (struct ohash *h,
+		hash_hash_func *hash, hash_less_func *less, void *aux) {
+	h->elem_cnt = 0;
+	h->slot_cnt = OHASH_MIN_SLOTS;
+	h->slots = calloc (h->slot_cnt, sizeof *h->slots);
+	h->old_slot_cnt = 0;
+	h->old_slots = NULL;
+	h->old_elem_cnt = 0;
+	h->old_pos = 0;
+	h->hash = hash;
+	h->less = less;
+	h->aux = aux;
+	return h->slots != NULL;
+}
+
+/* Removes all the elements from H, calling DESTRUCTOR on each if
+   it is non-null.  The same restrictions apply as for
+   hash_clear(). */
+void
+ohash_clear (struct ohash *h, hash_action_func *destructor) {
+	size_t i;
+
+	for (i = 0; i < h->slot_cnt; i++) {
+		if (destructor != NULL && h->slots[i].elem != NULL)
+			destructor (h->slots[i].elem, h->aux);
+		h->slots[i].elem = NULL;
+	}
+	for (i = 0; i < h->old_slot_cnt; i++)
+		if (destructor != NULL && h->old_slots[i].elem != NULL)
+			destructor (h->old_slots[i].elem, h->aux);
+
+	free (h->old_slots);
+	h->old_slots = NULL;
+	h->old_slot_cnt = 0;
+	h->old_elem_cnt = 0;
+	h->elem_cnt = 0;
+}
+
+/* Destroys hash table H, first calling DESTRUCTOR on each
+   element if it is non-null.  The same restrictions apply as
+   for hash_destroy(). */
+void
+ohash_destroy (struct ohash *h, hash_action_func *destructor) {
+	if (destructor != NULL)
+		ohash_clear (h, destructor);
+	free (h->old_slots);
+	free (h->slots);
+}
+
+/* Inserts NEW into hash table H and returns a null pointer, if
+   no equal element is already in the table.
+   If an equal element is already in the table, returns it
+   without inserting NEW. */
+struct hash_elem *
+ohash_insert (struct ohash *h, struct hash_elem *new) {
+	uint64_t hash = h->hash (new, h->aux);
+	struct ohash_slot *s = ohash_lookup (h, new, hash, NULL);
+
+	if (s != NULL)
+		return s->elem;
+
+	ohash_grow (h);
+	slots_insert (h->slots, h->slot_cnt, new, hash);
+	h->elem_cnt++;
+	ohash_migrate (h, OHASH_MIGRATE_STEP);
+	return NULL;
+}
+
+/* Inserts NEW into hash table H, replacing any equal element
+   already in the table, which is returned. */
+struct hash_elem *
+ohash_replace (struct ohash *h, struct hash_elem *new) {
+	uint64_t hash = h->hash (new, h->aux);
+	struct ohash_slot *s = ohash_lookup (h, new, hash, NULL);
+	struct hash_elem *old;
+
+	if (s == NULL)
+		return ohash_insert (h, new);
+
+	old = s->elem;
+	s->elem = new;
+	return old;
+}
+
+/* Finds and returns an element equal to E in hash table H, or a
+   null pointer if no equal element exists in the table. */
+struct hash_elem *
+ohash_find (struct ohash *h, struct hash_elem *e) {
+	struct ohash_slot *s = ohash_lookup (h, e, h->hash (e, h->aux), NULL);
+	return s != NULL ? s->elem : NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in hash
+   table H.  Returns a null pointer if no equal element existed
+   in the table. */
+struct hash_elem *
+ohash_delete (struct ohash *h, struct hash_elem *e) {
+	bool in_old;
+	struct ohash_slot *s = ohash_lookup (h, e, h->hash (e, h->aux), &in_old);
+	struct hash_elem *found;
+
+	if (s == NULL)
+		return NULL;
+
+	found = s->elem;
+	if (in_old) {
+		slots_remove (h->old_slots, h->old_slot_cnt, s);
+		h->old_elem_cnt--;
+	} else
+		slots_remove (h->slots, h->slot_cnt, s);
+	h->elem_cnt--;
+	ohash_migrate (h, OHASH_MIGRATE_STEP);
+	return found;
+}
+
+/* Calls ACTION for each element in hash table H in arbitrary
+   order.  The same restrictions apply as for hash_apply(). */
+void
+ohash_apply (struct ohash *h, hash_action_func *action) {
+	struct ohash_iterator i;
+
+	ASSERT (action != NULL);
+
+	ohash_first (&i, h);
+	while (ohash_next (&i))
+		action (ohash_cur (&i), h->aux);
+}
+
+/* Initializes I for iterating hash table H, in the same way as
+   hash_first(). */
+void
+ohash_first (struct ohash_iterator *i, struct ohash *h) {
+	ASSERT (i != NULL);
+	ASSERT (h != NULL);
+
+	i->hash = h;
+	i->pos = 0;
+	i->elem = NULL;
+}
+
+/* Advances I to the next element in the hash table and returns
+   it.  Returns a null pointer if no elements are left.  Elements
+   are returned in arbitrary order.  Modifying the table
+   invalidates all iterators. */
+struct hash_elem *
+ohash_next (struct ohash_iterator *i) {
+	struct ohash *h;
+
+	ASSERT (i != NULL);
+
+	h = i->hash;
+	i->elem = NULL;
+	while (i->elem == NULL && i->pos < h->slot_cnt + h->old_slot_cnt) {
+		size_t pos = i->pos++;
+		if (pos < h->slot_cnt)
+			i->elem = h->slots[pos].elem;
+		else
+			i->elem = h->old_slots[pos - h->slot_cnt].elem;
+	}
+	return i->elem;
+}
+
+/* Returns the current element in the hash table iteration, or a
+   null pointer at the end of the table. */
+struct hash_elem *
+ohash_cur (struct ohash_iterator *i) {
+	return i->elem;
+}
+
+/* Returns the number of elements in H. */
+size_t
+ohash_size (struct ohash *h) {
+	return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+ohash_empty (struct ohash *h) {
+	return h->elem_cnt == 0;
+}
+
+/* Returns the slot holding an element equal to E, whose hash
+   value is HASH, in either of H's arrays, or a null pointer if
+   there is none.  If IN_OLD is nonnull, sets *IN_OLD to whether
+   the slot is in the old array. */
+static struct ohash_slot *
+ohash_lookup (struct ohash *h, struct hash_elem *e, uint64_t hash,
+		bool *in_old) {
+	struct ohash_slot *s = slots_find (h, h->slots, h->slot_cnt, e, hash);
+	bool old = false;
+
+	if (s == NULL && h->old_slots != NULL) {
+		s = slots_find (h, h->old_slots, h->old_slot_cnt, e, hash);
+		old = true;
+	}
+	if (in_old != NULL)
+		*in_old = old;
+	return s;
+}
+
+/* Makes room in H for one more element, starting to move it to
+   an array twice the size if it is 3/4 full.  If the new array
+   cannot be allocated, H keeps filling its current one, and the
+   kernel panics only if that leaves no free slot. */
+static void
+ohash_grow (struct ohash *h) {
+	struct ohash_slot *slots;
+	size_t slot_cnt;
+
+	if ((h->elem_cnt + 1) * 4 <= h->slot_cnt * 3)
+		return;
+
+	/* Finish any earlier growth first.  This should not happen,
+	   given OHASH_MIGRATE_STEP. */
+	ohash_migrate (h, h->old_slot_cnt);
+
+	slot_cnt = h->slot_cnt * 2;
+	slots = calloc (slot_cnt, sizeof *slots);
+	if (slots == NULL) {
+		if (h->elem_cnt + 1 >= h->slot_cnt)
+			PANIC ("ohash: out of memory");
+		return;
+	}
+
+	h->old_slots = h->slots;
+	h->old_slot_cnt = h->slot_cnt;
+	h->old_elem_cnt = h->elem_cnt;
+	h->old_pos = 0;
+	h->slots = slots;
+	h->slot_cnt = slot_cnt;
+}
+
+/* Moves the elements in up to SLOT_CNT more slots of H's old
+   array into its current one, freeing the old array once it is
+   empty. */
+static void
+ohash_migrate (struct ohash *h, size_t slot_cnt) {
+	if (h->old_slots == NULL)
+		return;
+
+	while (h->old_elem_cnt > 0 && slot_cnt-- > 0) {
+		struct ohash_slot *s;
+
+		ASSERT (h->old_pos < h->old_slot_cnt);
+		s = &h->old_slots[h->old_pos++];
+
+		/* Removing S may shift a later element into it. */
+		while (s->elem != NULL) {
+			struct ohash_slot moved = *s;
+			slots_remove (h->old_slots, h->old_slot_cnt, s);
+			slots_insert (h->slots, h->slot_cnt, moved.elem, moved.hash);
+			h->old_elem_cnt--;
+		}
+	}
+
+	if (h->old_elem_cnt == 0) {
+		free (h->old_slots);
+		h->old_slots = NULL;
+		h->old_slot_cnt = 0;
+	}
+}
+
+/* Returns the number of slots between the slot at index I of an
+   array of SLOT_CNT slots and the home slot of hash value HASH. */
+static inline size_t
+probe_dist (size_t i, uint64_t hash, size_t slot_cnt) {
+	return (i - hash) & (slot_cnt - 1);
+}
+
+/* Returns the slot in SLOTS, an array of SLOT_CNT slots of H,
+   that holds an element equal to E, whose hash value is HASH, or
+   a null pointer if there is none. */
+static struct ohash_slot *
+slots_find (struct ohash *h, struct ohash_slot *slots, size_t slot_cnt,
+		struct hash_elem *e, uint64_t hash) {
+	size_t i = hash & (slot_cnt - 1);
+	size_t dist;
+
+	/* Robin Hood ordering means that once we pass an element
+	   closer to its home than E would be to its own, E is not
+	   in the table. */
+	for (dist = 0; ; dist++, i = (i + 1) & (slot_cnt - 1)) {
+		struct ohash_slot *s = &slots[i];
+
+		if (s->elem == NULL || probe_dist (i, s->hash, slot_cnt) < dist)
+			return NULL;
+		if (s->hash == hash
+				&& !h->less (s->elem, e, h->aux) && !h->less (e, s->elem, h->aux))
+			return s;
+	}
+}
+
+/* Inserts E, whose hash value is HASH, into SLOTS, an array of
+   SLOT_CNT slots that must have at least one free slot.  E
+   takes the place of the first element it finds that is closer
+   to its home slot, which then moves on in the same way. */
+static void
+slots_insert (struct ohash_slot *slots, size_t slot_cnt,
+		struct hash_elem *e, uint64_t hash) {
+	struct ohash_slot cur = { e, hash };
+	size_t i = hash & (slot_cnt - 1);
+	size_t dist;
+
+	for (dist = 0; ; dist++, i = (i + 1) & (slot_cnt - 1)) {
+		struct ohash_slot *s = &slots[i];
+		size_t s_dist;
+
+		if (s->elem == NULL) {
+			*s = cur;
+			return;
+		}
+		s_dist = probe_dist (i, s->hash, slot_cnt);
+		if (s_dist < dist) {
+			struct ohash_slot tmp = *s;
+			*s = cur;
+			cur = tmp;
+			dist = s_dist;
+		}
+	}
+}
+
+/* Removes the element in slot S of SLOTS, an array of SLOT_CNT
+   slots, moving each following element that is not in its home
+   slot back by one. */
+static void
+slots_remove (struct ohash_slot *slots, size_t slot_cnt,
+		struct ohash_slot *s) {
+	size_t i = s - slots;
+
+	for (;;) {
+		size_t j = (i + 1) & (slot_cnt - 1);
+
+		if (slots[j].elem == NULL || probe_dist (j, slots[j].hash, slot_cnt) == 0)
+			break;
+		slots[i] = slots[j];
+		i = j;
+	}
+	slots[i].elem = NULL;
+}
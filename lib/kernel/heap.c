@@ -0,0 +1,180 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* A pairing heap is a tree in which every node is at least as
+   great as its children.  Each node points to its first child,
+   and the children of a node form a doubly linked sibling list
+   whose first `prev' link points back up to the parent:
+
+       root
+        |
+        v
+       [A] <--> [B] <--> [C]        A->prev == root
+        |
+        v
+       [D] <--> [E]                 D->prev == A
+
+   Melding two trees makes the lesser root the first child of the
+   greater one.  Removing a node melds its children together in
+   two passes (left-to-right in pairs, then right-to-left), which
+   is what keeps the amortized cost logarithmic. */
+
+static struct heap_elem *meld (struct heap *,
+		struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) {
+	ASSERT (heap != NULL);
+	ASSERT (less != NULL);
+
+	heap->root = NULL;
+	heap->size = 0;
+	heap->less = less;
+	heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_push (struct heap *heap, struct heap_elem *elem) {
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+
+	elem->child = elem->next = elem->prev = NULL;
+	heap->root = meld (heap, heap->root, elem);
+	heap->size++;
+}
+
+/* Removes the greatest element from HEAP and returns it.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *
+heap_pop (struct heap *heap) {
+	struct heap_elem *top = heap_top (heap);
+
+	heap_remove (heap, top);
+	return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP.  ELEM's key
+   need not be consistent with its position, so this may also be
+   used to take out an element whose key was changed in place. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) {
+	struct heap_elem *sub;
+
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+	ASSERT (heap->size > 0);
+
+	sub = merge_pairs (heap, elem->child);
+	if (elem == heap->root)
+		heap->root = sub;
+	else {
+		/* Unlink ELEM from its parent and siblings. */
+		if (elem->prev->child == elem)
+			elem->prev->child = elem->next;
+		else
+			elem->prev->next = elem->next;
+		if (elem->next != NULL)
+			elem->next->prev = elem->prev;
+		heap->root = meld (heap, heap->root, sub);
+	}
+	elem->child = elem->next = elem->prev = NULL;
+	heap->size--;
+}
+
+/* Restores the heap property after ELEM's key, ELEM being in
+   HEAP, was changed. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem) {
+	heap_remove (heap, elem);
+	heap_push (heap, elem);
+}
+
+/* Returns the greatest element in HEAP.  Undefined behavior if
+   HEAP is empty. */
+struct heap_elem *
+heap_top (struct heap *heap) {
+	ASSERT (heap != NULL);
+	ASSERT (heap->root != NULL);
+
+	return heap->root;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (struct heap *heap) {
+	ASSERT (heap != NULL);
+
+	return heap->size;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (struct heap *heap) {
+	ASSERT (heap != NULL);
+
+	return heap->root == NULL;
+}
+
+/* Melds the trees rooted at A and B, either of which may be
+   null, and returns the root of the result.  A and B must not
+   have siblings. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+
+	if (heap->less (a, b, heap->aux)) {
+		struct heap_elem *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	/* Make B the first child of A. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	a->next = a->prev = NULL;
+	return a;
+}
+
+/* Melds the sibling list starting at FIRST into a single tree
+   and returns its root, or null if FIRST is null. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) {
+	struct heap_elem *stack = NULL;
+	struct heap_elem *root = NULL;
+
+	/* Left to right: meld siblings in pairs, stacking the results
+	   through their (now unused) `next' links. */
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL) {
+			b->next = b->prev = NULL;
+			a = meld (heap, a, b);
+		}
+		a->next = stack;
+		stack = a;
+	}
+
+	/* Right to left: meld the pairs into one tree. */
+	while (stack != NULL) {
+		struct heap_elem *next = stack->next;
+
+		stack->next = NULL;
+		root = meld (heap, root, stack);
+		stack = next;
+	}
+	return root;
+}
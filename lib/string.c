@@ -1,5 +1,43 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The kernel is built with -O0 and without SSE, so a byte loop
+   runs at a byte per cycle or worse.  Instead, bulk copies and
+   fills align the destination to a word with a few single bytes
+   and then let "rep movsq" or "rep stosq" move 8 bytes at a
+   time, and comparisons and string scans read whole aligned
+   8-byte words.  An aligned word never straddles a page
+   boundary, so the scans never touch a page the string does not
+   reach. */
+
+/* A word that may alias any other type. */
+typedef uint64_t __attribute__ ((may_alias)) word_t;
+
+/* Requests shorter than this many bytes are done a byte at a
+   time. */
+#define WORD_MIN 32
+
+/* Word with every byte set to 0x01 or 0x80. */
+#define ONES 0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+
+/* True if word W has a zero byte. */
+#define HAS_ZERO(W) ((((W) - ONES) & ~(W) & HIGHS) != 0)
+
+/* Copies CNT bytes, or CNT 8-byte words, forward from *SRC to
+   *DST, advancing both. */
+static inline void
+copy_bytes (unsigned char **dst, const unsigned char **src, size_t cnt) {
+	asm volatile ("rep movsb"
+			: "+D" (*dst), "+S" (*src), "+c" (cnt) : : "memory");
+}
+
+static inline void
+copy_words (unsigned char **dst, const unsigned char **src, size_t cnt) {
+	asm volatile ("rep movsq"
+			: "+D" (*dst), "+S" (*src), "+c" (cnt) : : "memory");
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -11,8 +49,15 @@ memcpy (void *dst_, const void *src_, size_t size) {
 	ASSERT (dst != NULL || size == 0);
 	ASSERT (src != NULL || size == 0);
 
-	while (size-- > 0)
-		*dst++ = *src++;
+	if (size >= WORD_MIN) {
+		size_t head = -(uintptr_t) dst & 7;
+
+		copy_bytes (&dst, &src, head);
+		size -= head;
+		copy_words (&dst, &src, size / 8);
+		size %= 8;
+	}
+	copy_bytes (&dst, &src, size);
 
 	return dst_;
 }
@@ -27,17 +72,34 @@ memmove (void *dst_, const void *src_, size_t size) {
 	ASSERT (dst != NULL || size == 0);
 	ASSERT (src != NULL || size == 0);
 
-	if (dst < src) {
-		while (size-- > 0)
-			*dst++ = *src++;
-	} else {
-		dst += size;
-		src += size;
-		while (size-- > 0)
+	/* A forward copy is safe unless DST starts inside SRC. */
+	if (dst <= src || dst >= src + size)
+		return memcpy (dst_, src_, size);
+
+	/* Copy backward: bytes until the end of DST is aligned, then
+	   words with the direction flag set, then the rest. */
+	dst += size;
+	src += size;
+	if (size >= WORD_MIN) {
+		size_t tail = (uintptr_t) dst & 7;
+		size_t words;
+
+		size -= tail;
+		while (tail-- > 0)
 			*--dst = *--src;
+		words = size / 8;
+		size %= 8;
+		dst -= 8;
+		src -= 8;
+		asm volatile ("std; rep movsq; cld"
+				: "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+		dst += 8;
+		src += 8;
 	}
+	while (size-- > 0)
+		*--dst = *--src;
 
-	return dst;
+	return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -52,6 +114,10 @@ memcmp (const void *a_, const void *b_, size_t size) {
 	ASSERT (a != NULL || size == 0);
 	ASSERT (b != NULL || size == 0);
 
+	/* Skip equal words, then find the differing byte. */
+	for (; size >= 8; a += 8, b += 8, size -= 8)
+		if (*(const word_t *) a != *(const word_t *) b)
+			break;
 	for (; size-- > 0; a++, b++)
 		if (*a != *b)
 			return *a > *b ? +1 : -1;
@@ -103,9 +169,25 @@ memchr (const void *block_, int ch_, size_t size) {
 char *
 strchr (const char *string, int c_) {
 	char c = c_;
+	uint64_t pattern = (unsigned char) c * ONES;
 
 	ASSERT (string);
 
+	/* Skip whole words with neither C nor a null byte. */
+	while ((uintptr_t) string & 7)
+		if (*string == c)
+			return (char *) string;
+		else if (*string == '\0')
+			return NULL;
+		else
+			string++;
+	for (;;) {
+		uint64_t w = *(const word_t *) string;
+		if (HAS_ZERO (w) || HAS_ZERO (w ^ pattern))
+			break;
+		string += 8;
+	}
+
 	for (;;)
 		if (*string == c)
 			return (char *) string;
@@ -260,6 +342,19 @@ memset (void *dst_, int value, size_t size) {
 
 	ASSERT (dst != NULL || size == 0);
 
+	if (size >= WORD_MIN) {
+		size_t head = -(uintptr_t) dst & 7;
+		uint64_t pattern = (unsigned char) value * ONES;
+		size_t words;
+
+		size -= head;
+		while (head-- > 0)
+			*dst++ = value;
+		words = size / 8;
+		size %= 8;
+		asm volatile ("rep stosq"
+				: "+D" (dst), "+c" (words) : "a" (pattern) : "memory");
+	}
 	while (size-- > 0)
 		*dst++ = value;
 
@@ -273,7 +368,13 @@ strlen (const char *string) {
 
 	ASSERT (string);
 
-	for (p = string; *p != '\0'; p++)
+	/* Find the word holding the null byte, then the byte. */
+	for (p = string; (uintptr_t) p & 7; p++)
+		if (*p == '\0')
+			return p - string;
+	while (!HAS_ZERO (*(const word_t *) p))
+		p += 8;
+	for (; *p != '\0'; p++)
 		continue;
 	return p - string;
 }
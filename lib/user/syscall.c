@@ -194,3 +194,13 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+int
+schedstat (struct sched_stats *thread, struct sched_stats *global) {
+	return syscall2 (SYS_SCHEDSTAT, thread, global);
+}
+
+int
+memquota (size_t limit, size_t reserve) {
+	return syscall2 (SYS_MEMQUOTA, limit, reserve);
+}
@@ -6,7 +6,9 @@
 #include <syscall.h>
 #include <userprog/syscall.h>
 
-const char *test_name;
+/* Weak, so that a test whose own source defines test_name, such
+   as a child program, links without common symbols. */
+const char *test_name __attribute__ ((weak));
 bool quiet = false;
 
 static void
@@ -0,0 +1,90 @@
+/* Compares bitmap_scan() against a scan that tests candidate
+   starts one bit at a time, as bitmap_scan() used to, on large
+   sparse (2% set) and dense (98% set) bitmaps, looking for runs
+   of free bits of several lengths from several starting points.
+   Both must give the same answers. */
+
+#include <bitmap.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "intrinsic.h"
+
+#define BIT_CNT 65536
+#define START_CNT 16
+
+static size_t naive_scan (const struct bitmap *, size_t start, size_t cnt);
+static void bench (const char *name, const struct bitmap *);
+
+void
+test_bitmap_bench (void) 
+{
+  struct bitmap *b = bitmap_create (BIT_CNT);
+  size_t i;
+
+  ASSERT (b != NULL);
+  random_init (0x5eed);
+
+  for (i = 0; i < BIT_CNT; i++)
+    bitmap_set (b, i, random_ulong () % 100 < 2);
+  bench ("sparse", b);
+
+  for (i = 0; i < BIT_CNT; i++)
+    bitmap_set (b, i, random_ulong () % 100 < 98);
+  bench ("dense", b);
+
+  bitmap_destroy (b);
+}
+
+/* Scans B for runs of false bits of several lengths and reports
+   the cycles per scan of each method under NAME. */
+static void
+bench (const char *name, const struct bitmap *b) 
+{
+  static const size_t cnts[] = { 1, 8, 64 };
+  size_t c, s;
+
+  for (c = 0; c < sizeof cnts / sizeof *cnts; c++)
+    {
+      uint64_t naive = 0, fast = 0;
+
+      for (s = 0; s < START_CNT; s++)
+        {
+          size_t start = BIT_CNT / START_CNT * s;
+          size_t expect, got;
+          uint64_t t;
+
+          t = rdtsc ();
+          expect = naive_scan (b, start, cnts[c]);
+          naive += rdtsc () - t;
+
+          t = rdtsc ();
+          got = bitmap_scan (b, start, cnts[c], false);
+          fast += rdtsc () - t;
+
+          if (got != expect)
+            fail ("%s: scan for %zu from %zu gave %zu, expected %zu",
+                  name, cnts[c], start, got, expect);
+        }
+      msg ("%s, runs of %zu: bit by bit %llu, by word %llu cycles per scan",
+           name, cnts[c], naive / START_CNT, fast / START_CNT);
+    }
+}
+
+/* Returns the first index at or after START of CNT false bits in
+   B, testing each candidate start bit by bit. */
+static size_t
+naive_scan (const struct bitmap *b, size_t start, size_t cnt) 
+{
+  size_t i, j;
+
+  for (i = start; i + cnt <= bitmap_size (b); i++)
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j))
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
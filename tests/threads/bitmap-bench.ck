@@ -0,0 +1,29 @@
+# -*- perl -*-
+
+# The expected output looks like this, where C varies from run
+# to run:
+#
+# (bitmap-bench) sparse, runs of 1: bit by bit C, by word C cycles per scan
+# (bitmap-bench) sparse, runs of 8: bit by bit C, by word C cycles per scan
+# (bitmap-bench) sparse, runs of 64: bit by bit C, by word C cycles per scan
+# (bitmap-bench) dense, runs of 1: bit by bit C, by word C cycles per scan
+# (bitmap-bench) dense, runs of 8: bit by bit C, by word C cycles per scan
+# (bitmap-bench) dense, runs of 64: bit by bit C, by word C cycles per scan
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+for my $map ('sparse', 'dense') {
+    for my $cnt (1, 8, 64) {
+        fail "$map bitmap, runs of $cnt, did not report its costs.\n"
+          if !grep (/^\(bitmap-bench\) $map, runs of $cnt: bit by bit \d+, by word \d+ cycles per scan$/, @output);
+    }
+}
+
+pass;
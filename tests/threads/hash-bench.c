@@ -0,0 +1,189 @@
+/* Inserts, looks up, misses, and deletes the same keys in a
+   chained struct hash and an open-addressing struct ohash, and
+   reports the average cycles per operation of each, along with
+   the most cycles any single insertion took, which shows how
+   much one growth step costs.  Both tables' answers are
+   checked as it goes. */
+
+#include <hash.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "intrinsic.h"
+
+#define ITEM_CNT 8192
+
+struct item
+  {
+    int key;
+    struct hash_elem elem;
+  };
+
+/* Operations of one table, so that both can share a driver. */
+struct table_ops
+  {
+    const char *name;
+    struct hash_elem *(*insert) (void *, struct hash_elem *);
+    struct hash_elem *(*find) (void *, struct hash_elem *);
+    struct hash_elem *(*delete) (void *, struct hash_elem *);
+    size_t (*size) (void *);
+  };
+
+static uint64_t item_hash (const struct hash_elem *, void *);
+static bool item_less (const struct hash_elem *, const struct hash_elem *,
+                       void *);
+static void run (const struct table_ops *, void *table, struct item *);
+
+static struct hash_elem *
+chained_insert (void *h, struct hash_elem *e) 
+{
+  return hash_insert (h, e);
+}
+
+static struct hash_elem *
+chained_find (void *h, struct hash_elem *e) 
+{
+  return hash_find (h, e);
+}
+
+static struct hash_elem *
+chained_delete (void *h, struct hash_elem *e) 
+{
+  return hash_delete (h, e);
+}
+
+static size_t
+chained_size (void *h) 
+{
+  return hash_size (h);
+}
+
+static struct hash_elem *
+open_insert (void *h, struct hash_elem *e) 
+{
+  return ohash_insert (h, e);
+}
+
+static struct hash_elem *
+open_find (void *h, struct hash_elem *e) 
+{
+  return ohash_find (h, e);
+}
+
+static struct hash_elem *
+open_delete (void *h, struct hash_elem *e) 
+{
+  return ohash_delete (h, e);
+}
+
+static size_t
+open_size (void *h) 
+{
+  return ohash_size (h);
+}
+
+void
+test_hash_bench (void) 
+{
+  static const struct table_ops chained_ops =
+    { "chained", chained_insert, chained_find, chained_delete, chained_size };
+  static const struct table_ops open_ops =
+    { "open", open_insert, open_find, open_delete, open_size };
+  struct item *items = malloc (sizeof *items * ITEM_CNT);
+  struct hash chained;
+  struct ohash open;
+  int i;
+
+  ASSERT (items != NULL);
+
+  /* Random distinct keys: odd numbers, so that even ones miss. */
+  random_init (0x5eed);
+  for (i = 0; i < ITEM_CNT; i++)
+    items[i].key = (random_ulong () % (1 << 20)) * ITEM_CNT * 2 + i * 2 + 1;
+
+  if (!hash_init (&chained, item_hash, item_less, NULL))
+    fail ("chained: out of memory");
+  run (&chained_ops, &chained, items);
+  hash_destroy (&chained, NULL);
+
+  if (!ohash_init (&open, item_hash, item_less, NULL))
+    fail ("open: out of memory");
+  run (&open_ops, &open, items);
+  ohash_destroy (&open, NULL);
+
+  free (items);
+}
+
+/* Runs every operation of OPS on TABLE, which must be empty,
+   over ITEMS, and reports the costs. */
+static void
+run (const struct table_ops *ops, void *table, struct item *items) 
+{
+  uint64_t start, cycles, worst;
+  uint64_t insert, find, miss, delete;
+  struct item probe;
+  int i;
+
+  insert = worst = 0;
+  for (i = 0; i < ITEM_CNT; i++)
+    {
+      start = rdtsc ();
+      if (ops->insert (table, &items[i].elem) != NULL)
+        fail ("%s: key %d inserted twice", ops->name, items[i].key);
+      cycles = rdtsc () - start;
+      insert += cycles;
+      if (cycles > worst)
+        worst = cycles;
+    }
+  if (ops->insert (table, &items[0].elem) != &items[0].elem)
+    fail ("%s: duplicate insertion was not refused", ops->name);
+
+  start = rdtsc ();
+  for (i = 0; i < ITEM_CNT; i++)
+    {
+      probe.key = items[i].key;
+      if (ops->find (table, &probe.elem) != &items[i].elem)
+        fail ("%s: key %d not found", ops->name, probe.key);
+    }
+  find = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < ITEM_CNT; i++)
+    {
+      probe.key = items[i].key + 1;
+      if (ops->find (table, &probe.elem) != NULL)
+        fail ("%s: missing key %d found", ops->name, probe.key);
+    }
+  miss = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < ITEM_CNT; i++)
+    {
+      probe.key = items[i].key;
+      if (ops->delete (table, &probe.elem) != &items[i].elem)
+        fail ("%s: key %d not deleted", ops->name, probe.key);
+    }
+  delete = rdtsc () - start;
+  if (ops->size (table) != 0)
+    fail ("%s: %zu elements left", ops->name, ops->size (table));
+
+  msg ("%s: insert %llu, find %llu, miss %llu, delete %llu cycles per op",
+       ops->name, insert / ITEM_CNT, find / ITEM_CNT, miss / ITEM_CNT,
+       delete / ITEM_CNT);
+  msg ("%s: worst insert %llu cycles", ops->name, worst);
+}
+
+static uint64_t
+item_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  return hash_int (hash_entry (e, struct item, elem)->key);
+}
+
+static bool
+item_less (const struct hash_elem *a, const struct hash_elem *b,
+           void *aux UNUSED) 
+{
+  return (hash_entry (a, struct item, elem)->key
+          < hash_entry (b, struct item, elem)->key);
+}
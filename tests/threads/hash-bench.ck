@@ -0,0 +1,27 @@
+# -*- perl -*-
+
+# The expected output looks like this, where C varies from run
+# to run:
+#
+# (hash-bench) chained: insert C, find C, miss C, delete C cycles per op
+# (hash-bench) chained: worst insert C cycles
+# (hash-bench) open: insert C, find C, miss C, delete C cycles per op
+# (hash-bench) open: worst insert C cycles
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+for my $name ('chained', 'open') {
+    fail "$name table did not report its costs.\n"
+      if !grep (/^\(hash-bench\) $name: insert \d+, find \d+, miss \d+, delete \d+ cycles per op$/, @output);
+    fail "$name table did not report its worst insertion.\n"
+      if !grep (/^\(hash-bench\) $name: worst insert \d+ cycles$/, @output);
+}
+
+pass;
@@ -0,0 +1,87 @@
+/* Checks that realloc() keeps a block in place when it still
+   fits, that malloc_usable_size() covers the requested size, and
+   that big blocks shrink in place and keep their contents when
+   they grow, whether or not they had to move. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+
+#define BIG_SIZE (2 * PGSIZE)
+
+static void fill (unsigned char *, size_t);
+static bool check (const unsigned char *, size_t);
+
+void
+test_malloc_realloc (void) 
+{
+  unsigned char *p, *q;
+  size_t usable;
+
+  /* A normal block grows into its slack without moving. */
+  p = malloc (100);
+  ASSERT (p != NULL);
+  usable = malloc_usable_size (p);
+  if (usable < 100)
+    fail ("usable size %zu is less than 100", usable);
+  fill (p, 100);
+  q = realloc (p, usable);
+  if (q != p)
+    fail ("realloc to usable size moved the block");
+  if (!check (q, 100))
+    fail ("contents changed");
+  msg ("small block grew in place");
+
+  /* Past its slack it must move. */
+  p = realloc (q, usable + 1);
+  ASSERT (p != NULL);
+  if (!check (p, 100))
+    fail ("contents changed on move");
+  free (p);
+
+  /* A big block gives back pages without moving. */
+  p = malloc (BIG_SIZE);
+  ASSERT (p != NULL);
+  fill (p, PGSIZE);
+  q = realloc (p, PGSIZE);
+  if (q != p)
+    fail ("shrinking a big block moved it");
+  if (malloc_usable_size (q) < PGSIZE)
+    fail ("usable size %zu is less than %d", malloc_usable_size (q),
+          PGSIZE);
+  msg ("big block shrank in place");
+
+  /* Growing it again reuses the page it just gave back, unless
+     another thread took it in the meantime. */
+  p = realloc (q, BIG_SIZE);
+  ASSERT (p != NULL);
+  if (!check (p, PGSIZE))
+    fail ("contents changed on growth");
+  msg ("big block grew %s", p == q ? "in place" : "by moving");
+  free (p);
+}
+
+/* Fills the first SIZE bytes of P with a pattern. */
+static void
+fill (unsigned char *p, size_t size) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    p[i] = i * 7;
+}
+
+/* Returns true if the first SIZE bytes of P still hold the
+   pattern. */
+static bool
+check (const unsigned char *p, size_t size) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != (unsigned char) (i * 7))
+      return false;
+  return true;
+}
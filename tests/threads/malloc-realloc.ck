@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(malloc-realloc) begin
+(malloc-realloc) small block grew in place
+(malloc-realloc) big block shrank in place
+(malloc-realloc) big block grew in place
+(malloc-realloc) end
+EOF
+(malloc-realloc) begin
+(malloc-realloc) small block grew in place
+(malloc-realloc) big block shrank in place
+(malloc-realloc) big block grew by moving
+(malloc-realloc) end
+EOF
+pass;
@@ -0,0 +1,104 @@
+/* Runs the same short, contended critical section under a
+   struct lock and under a struct mutex and reports how many
+   context switches and cycles each costs per operation.  Each
+   run must also leave the shared counter at the right value. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define THREAD_CNT 8
+#define ITER_CNT 2000
+#define WORK_CNT 200
+
+struct bench
+  {
+    bool use_mutex;             /* Which primitive to exercise. */
+    struct lock lock;
+    struct mutex mutex;
+    struct semaphore done;      /* Upped once per finished thread. */
+    volatile int counter;       /* Protected by lock or mutex. */
+  };
+
+static thread_func bench_thread;
+static void run_bench (struct bench *, const char *name);
+
+void
+test_mutex_bench (void) 
+{
+  static struct bench b;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  b.use_mutex = false;
+  run_bench (&b, "lock");
+  b.use_mutex = true;
+  run_bench (&b, "mutex");
+}
+
+static void
+run_bench (struct bench *b, const char *name) 
+{
+  struct sched_stats before, after;
+  uint64_t start, cycles;
+  long long switches;
+  int i;
+
+  lock_init (&b->lock);
+  mutex_init (&b->mutex);
+  sema_init (&b->done, 0);
+  b->counter = 0;
+
+  thread_get_sched_stats (NULL, &before);
+  start = rdtsc ();
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char tname[16];
+      snprintf (tname, sizeof tname, "%s %d", name, i);
+      thread_create (tname, PRI_DEFAULT, bench_thread, b);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&b->done);
+  cycles = rdtsc () - start;
+  thread_get_sched_stats (NULL, &after);
+
+  if (b->counter != THREAD_CNT * ITER_CNT)
+    fail ("%s: counter is %d, expected %d",
+          name, b->counter, THREAD_CNT * ITER_CNT);
+  msg ("%s: counter ok", name);
+
+  switches = after.ctx_switches - before.ctx_switches;
+  printf ("(mutex-bench) %s: %lld switches per 1000 ops, "
+          "%llu cycles per op\n", name,
+          switches * 1000 / (THREAD_CNT * ITER_CNT),
+          cycles / (THREAD_CNT * ITER_CNT));
+}
+
+static void
+bench_thread (void *b_) 
+{
+  struct bench *b = b_;
+  int i, j;
+
+  for (i = 0; i < ITER_CNT; i++) 
+    {
+      if (b->use_mutex)
+        mutex_acquire (&b->mutex);
+      else
+        lock_acquire (&b->lock);
+
+      b->counter++;
+      for (j = 0; j < WORK_CNT; j++)
+        barrier ();
+
+      if (b->use_mutex)
+        mutex_release (&b->mutex);
+      else
+        lock_release (&b->lock);
+    }
+  sema_up (&b->done);
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+
+# The expected output looks like this, where N and C vary
+# from run to run:
+#
+# (mutex-bench) lock: counter ok
+# (mutex-bench) lock: N switches per 1000 ops, C cycles per op
+# (mutex-bench) mutex: counter ok
+# (mutex-bench) mutex: N switches per 1000 ops, C cycles per op
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+for my $name ('lock', 'mutex') {
+    fail "$name run did not finish with the right counter.\n"
+      if !grep (/^\(mutex-bench\) $name: counter ok$/, @output);
+    fail "$name run did not report its costs.\n"
+      if !grep (/^\(mutex-bench\) $name: \d+ switches per 1000 ops, \d+ cycles per op$/, @output);
+}
+
+pass;
@@ -0,0 +1,91 @@
+/* Checks page_zero() and page_copy(), and compares the cycles
+   per page of memset(), page_zero(), and PAL_ZERO allocations
+   made right after freeing some pages and sleeping, which the
+   idle thread should have had time to zero. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define PAGE_CNT 32
+#define ROUNDS 64
+
+static bool all_zero (const void *page);
+
+void
+test_page_zero (void) 
+{
+  static void *pages[PAGE_CNT];
+  uint8_t *a, *b;
+  uint64_t start, cycles;
+  size_t i;
+  int r;
+
+  a = palloc_get_page (PAL_ASSERT);
+  b = palloc_get_page (PAL_ASSERT);
+
+  /* Correctness. */
+  memset (a, 0x5a, PGSIZE);
+  page_zero (a);
+  if (!all_zero (a))
+    fail ("page_zero left nonzero bytes");
+  for (i = 0; i < PGSIZE; i++)
+    a[i] = i * 7;
+  page_copy (b, a);
+  if (memcmp (a, b, PGSIZE))
+    fail ("page_copy copied wrong bytes");
+  msg ("page_zero and page_copy are correct");
+
+  /* Synchronous zeroing. */
+  start = rdtsc ();
+  for (r = 0; r < ROUNDS; r++)
+    memset (a, 0, PGSIZE);
+  msg ("memset: %llu cycles per page", (rdtsc () - start) / ROUNDS);
+
+  start = rdtsc ();
+  for (r = 0; r < ROUNDS; r++)
+    page_zero (a);
+  msg ("page_zero: %llu cycles per page", (rdtsc () - start) / ROUNDS);
+
+  /* Allocation after the idle thread has had time to zero the
+     pages freed here. */
+  for (i = 0; i < PAGE_CNT; i++)
+    pages[i] = palloc_get_page (PAL_ASSERT);
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+  timer_sleep (TIMER_FREQ / 10);
+  cycles = 0;
+  for (i = 0; i < PAGE_CNT; i++) 
+    {
+      start = rdtsc ();
+      pages[i] = palloc_get_page (PAL_ZERO);
+      cycles += rdtsc () - start;
+      if (pages[i] == NULL)
+        fail ("out of pages");
+      if (!all_zero (pages[i]))
+        fail ("PAL_ZERO page %zu has nonzero bytes", i);
+    }
+  msg ("palloc PAL_ZERO: %llu cycles per page", cycles / PAGE_CNT);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+  palloc_free_page (b);
+  palloc_free_page (a);
+}
+
+/* Returns true if every byte of PAGE is zero. */
+static bool
+all_zero (const void *page) 
+{
+  const uint8_t *p = page;
+  size_t i;
+
+  for (i = 0; i < PGSIZE; i++)
+    if (p[i] != 0)
+      return false;
+  return true;
+}
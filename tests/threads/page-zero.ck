@@ -0,0 +1,27 @@
+# -*- perl -*-
+
+# The expected output looks like this, where C varies from run
+# to run:
+#
+# (page-zero) page_zero and page_copy are correct
+# (page-zero) memset: C cycles per page
+# (page-zero) page_zero: C cycles per page
+# (page-zero) palloc PAL_ZERO: C cycles per page
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "page_zero or page_copy is wrong.\n"
+  if !grep (/^\(page-zero\) page_zero and page_copy are correct$/, @output);
+for my $name ('memset', 'page_zero', 'palloc PAL_ZERO') {
+    fail "$name did not report its cost.\n"
+      if !grep (/^\(page-zero\) $name: \d+ cycles per page$/, @output);
+}
+
+pass;
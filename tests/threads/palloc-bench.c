@@ -0,0 +1,136 @@
+/* Runs the same random mix of multi-page allocations and frees
+   against a first-fit bitmap, as palloc uses by default, and
+   against the buddy allocator used with -buddy, and reports
+   the cycles per operation of each, counting only the calls
+   into the allocator.  Only page indexes are handed out, so no
+   real memory is needed.  The buddy run is checked against a
+   bitmap of its own as it goes. */
+
+#include <bitmap.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/buddy.h"
+#include "threads/malloc.h"
+#include "intrinsic.h"
+
+#define PAGE_CNT 4096
+#define SLOT_CNT 512
+#define OP_CNT 20000
+#define SEED 0x5eed
+
+struct slot
+  {
+    size_t idx;                 /* First page. */
+    size_t cnt;                 /* Number of pages, 0 if unused. */
+  };
+
+static struct slot slots[SLOT_CNT];
+
+static size_t random_size (void);
+
+void
+test_palloc_bench (void) 
+{
+  struct bitmap *map = bitmap_create (PAGE_CNT);
+  struct bitmap *check = bitmap_create (PAGE_CNT);
+  void *meta = malloc (buddy_meta_size (PAGE_CNT));
+  struct buddy buddy;
+  uint64_t start, cycles;
+  int i, fails;
+
+  ASSERT (map != NULL && check != NULL && meta != NULL);
+
+  /* First-fit bitmap. */
+  random_init (SEED);
+  memset (slots, 0, sizeof slots);
+  fails = 0;
+  cycles = 0;
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      struct slot *s = &slots[random_ulong () % SLOT_CNT];
+      if (s->cnt != 0)
+        {
+          start = rdtsc ();
+          bitmap_set_multiple (map, s->idx, s->cnt, false);
+          cycles += rdtsc () - start;
+          s->cnt = 0;
+        }
+      else
+        {
+          size_t cnt = random_size ();
+          start = rdtsc ();
+          s->idx = bitmap_scan_and_flip (map, 0, cnt, false);
+          cycles += rdtsc () - start;
+          if (s->idx != BITMAP_ERROR)
+            s->cnt = cnt;
+          else
+            fails++;
+        }
+    }
+  msg ("bitmap: %llu cycles per op, %d failed allocations",
+       cycles / OP_CNT, fails);
+
+  /* Buddy allocator. */
+  buddy_init (&buddy, PAGE_CNT, meta);
+  buddy_free (&buddy, 0, PAGE_CNT);
+  random_init (SEED);
+  memset (slots, 0, sizeof slots);
+  fails = 0;
+  cycles = 0;
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      struct slot *s = &slots[random_ulong () % SLOT_CNT];
+      if (s->cnt != 0)
+        {
+          ASSERT (bitmap_all (check, s->idx, s->cnt));
+          bitmap_set_multiple (check, s->idx, s->cnt, false);
+          start = rdtsc ();
+          buddy_free (&buddy, s->idx, s->cnt);
+          cycles += rdtsc () - start;
+          s->cnt = 0;
+        }
+      else
+        {
+          size_t cnt = random_size ();
+          start = rdtsc ();
+          s->idx = buddy_alloc (&buddy, cnt);
+          cycles += rdtsc () - start;
+          if (s->idx == BUDDY_ERROR)
+            {
+              fails++;
+              continue;
+            }
+          if (!bitmap_none (check, s->idx, cnt))
+            fail ("buddy handed out page %zu twice", s->idx);
+          bitmap_set_multiple (check, s->idx, cnt, true);
+          s->cnt = cnt;
+        }
+    }
+  msg ("buddy: %llu cycles per op, %d failed allocations",
+       cycles / OP_CNT, fails);
+
+  /* Everything freed must merge back into whole blocks. */
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].cnt != 0)
+      buddy_free (&buddy, slots[i].idx, slots[i].cnt);
+  if (buddy_free_cnt (&buddy) != PAGE_CNT
+      || buddy_alloc (&buddy, PAGE_CNT) != 0)
+    fail ("buddy did not merge freed blocks");
+  msg ("buddy: all blocks merged");
+
+  free (meta);
+  bitmap_destroy (check);
+  bitmap_destroy (map);
+}
+
+/* Returns a request size: mostly single pages, sometimes up to
+   16. */
+static size_t
+random_size (void) 
+{
+  if (random_ulong () % 4 != 0)
+    return 1;
+  return 1 + random_ulong () % 16;
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+
+# The expected output looks like this, where C and F vary
+# from run to run:
+#
+# (palloc-bench) bitmap: C cycles per op, F failed allocations
+# (palloc-bench) buddy: C cycles per op, F failed allocations
+# (palloc-bench) buddy: all blocks merged
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+for my $name ('bitmap', 'buddy') {
+    fail "$name run did not report its costs.\n"
+      if !grep (/^\(palloc-bench\) $name: \d+ cycles per op, \d+ failed allocations$/, @output);
+}
+fail "Buddy allocator did not merge freed blocks.\n"
+  if !grep (/^\(palloc-bench\) buddy: all blocks merged$/, @output);
+
+pass;
@@ -0,0 +1,105 @@
+/* Allocates and frees batches of inode-sized objects with
+   malloc() and with a kmem_cache, and reports the cycles per
+   operation and the pages used by each.  Also checks that the
+   cache's constructor runs on every object it hands out. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+#define OBJ_SIZE 544            /* Size of a struct inode. */
+#define OBJ_CNT 256
+#define ROUND_CNT 16
+#define CTOR_MAGIC 0x2a
+
+static void *objs[OBJ_CNT];
+
+static void ctor (void *);
+static size_t count_pages (void);
+
+void
+test_slab_bench (void) 
+{
+  struct kmem_cache *cache;
+  uint64_t start, cycles;
+  size_t pages;
+  int round, i;
+
+  /* malloc(). */
+  pages = 0;
+  cycles = 0;
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      start = rdtsc ();
+      for (i = 0; i < OBJ_CNT; i++)
+        objs[i] = malloc (OBJ_SIZE);
+      cycles += rdtsc () - start;
+      if (round == 0)
+        pages = count_pages ();
+      start = rdtsc ();
+      for (i = 0; i < OBJ_CNT; i++)
+        free (objs[i]);
+      cycles += rdtsc () - start;
+    }
+  msg ("malloc: %llu cycles per op, %zu pages",
+       cycles / (2 * ROUND_CNT * OBJ_CNT), pages);
+
+  /* kmem_cache. */
+  cache = kmem_cache_create ("slab-bench", OBJ_SIZE, ctor);
+  ASSERT (cache != NULL);
+  pages = 0;
+  cycles = 0;
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      start = rdtsc ();
+      for (i = 0; i < OBJ_CNT; i++)
+        objs[i] = kmem_cache_alloc (cache);
+      cycles += rdtsc () - start;
+      if (round == 0) 
+        {
+          pages = count_pages ();
+          if (pages != kmem_cache_pages (cache))
+            fail ("cache owns %zu pages but objects span %zu",
+                  kmem_cache_pages (cache), pages);
+        }
+      for (i = 0; i < OBJ_CNT; i++)
+        if (*(unsigned char *) objs[i] != CTOR_MAGIC)
+          fail ("constructor did not run on object %d", i);
+      start = rdtsc ();
+      for (i = 0; i < OBJ_CNT; i++)
+        kmem_cache_free (cache, objs[i]);
+      cycles += rdtsc () - start;
+    }
+  msg ("kmem_cache: %llu cycles per op, %zu pages",
+       cycles / (2 * ROUND_CNT * OBJ_CNT), pages);
+  msg ("kmem_cache: constructor ran on every object");
+}
+
+/* Marks an object as constructed. */
+static void
+ctor (void *obj) 
+{
+  memset (obj, CTOR_MAGIC, OBJ_SIZE);
+}
+
+/* Returns the number of distinct pages that objs[] point into. */
+static size_t
+count_pages (void) 
+{
+  size_t cnt = 0;
+  int i, j;
+
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      for (j = 0; j < i; j++)
+        if (pg_round_down (objs[j]) == pg_round_down (objs[i]))
+          break;
+      if (j == i)
+        cnt++;
+    }
+  return cnt;
+}
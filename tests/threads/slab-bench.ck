@@ -0,0 +1,30 @@
+# -*- perl -*-
+
+# The expected output looks like this, where C varies from run
+# to run and P depends on the allocator:
+#
+# (slab-bench) malloc: C cycles per op, P pages
+# (slab-bench) kmem_cache: C cycles per op, P pages
+# (slab-bench) kmem_cache: constructor ran on every object
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (%pages);
+for my $name ('malloc', 'kmem_cache') {
+    my ($line) = grep (/^\(slab-bench\) $name: \d+ cycles per op, \d+ pages$/, @output);
+    fail "$name run did not report its costs.\n" if !defined $line;
+    ($pages{$name}) = $line =~ /(\d+) pages$/;
+}
+fail "kmem_cache used more pages than malloc.\n"
+  if $pages{'kmem_cache'} > $pages{'malloc'};
+fail "Constructor check did not complete.\n"
+  if !grep (/^\(slab-bench\) kmem_cache: constructor ran on every object$/, @output);
+
+pass;
@@ -0,0 +1,152 @@
+/* Runs each of the word-at-a-time string functions on page-sized
+   buffers for a fixed number of timer ticks, checks the result,
+   and reports the throughput achieved in GB/s, next to a plain
+   byte-at-a-time copy loop for comparison. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define BUF_SIZE PGSIZE
+#define RUN_TICKS 20
+
+enum op { BYTE_LOOP, MEMCPY, MEMMOVE, MEMSET, MEMCMP, STRLEN, STRCHR, OP_CNT };
+
+static const char *op_names[OP_CNT] =
+  { "byte loop", "memcpy", "memmove", "memset", "memcmp", "strlen", "strchr" };
+
+static unsigned char *src, *dst;
+
+static void run_op (enum op);
+static void check_op (enum op);
+
+void
+test_string_bench (void) 
+{
+  enum op op;
+
+  src = palloc_get_multiple (PAL_ASSERT, 2);
+  dst = palloc_get_multiple (PAL_ASSERT, 2);
+
+  for (op = 0; op < OP_CNT; op++) 
+    {
+      unsigned long long iters = 0, rate;
+      int64_t start;
+
+      check_op (op);
+
+      /* Start on a tick boundary. */
+      start = timer_ticks ();
+      while (timer_ticks () == start)
+        continue;
+      start = timer_ticks ();
+      while (timer_elapsed (start) < RUN_TICKS) 
+        {
+          run_op (op);
+          iters++;
+        }
+
+      /* Bytes per second, in hundredths of a GB. */
+      rate = iters * BUF_SIZE * TIMER_FREQ / RUN_TICKS / 10000000;
+      msg ("%s: %llu.%02llu GB/s", op_names[op], rate / 100, rate % 100);
+    }
+
+  palloc_free_multiple (dst, 2);
+  palloc_free_multiple (src, 2);
+}
+
+/* Does one BUF_SIZE-byte run of OP. */
+static void
+run_op (enum op op) 
+{
+  size_t i;
+
+  switch (op) 
+    {
+    case BYTE_LOOP:
+      for (i = 0; i < BUF_SIZE; i++)
+        dst[i] = src[i];
+      break;
+    case MEMCPY:
+      memcpy (dst, src, BUF_SIZE);
+      break;
+    case MEMMOVE:
+      /* Overlapping, so it must copy backward. */
+      memmove (dst + 3, dst, BUF_SIZE);
+      break;
+    case MEMSET:
+      memset (dst, 0x5a, BUF_SIZE);
+      break;
+    case MEMCMP:
+      if (memcmp (dst, src, BUF_SIZE) != 0)
+        fail ("memcmp found a difference");
+      break;
+    case STRLEN:
+      if (strlen ((char *) src) != BUF_SIZE - 1)
+        fail ("strlen returned the wrong length");
+      break;
+    case STRCHR:
+      if (strchr ((char *) src, '@') != NULL)
+        fail ("strchr found a character that is not there");
+      break;
+    default:
+      NOT_REACHED ();
+    }
+}
+
+/* Sets up the buffers for OP and checks OP's result once on
+   unaligned, odd-sized arguments. */
+static void
+check_op (enum op op) 
+{
+  size_t i;
+
+  /* SRC holds a string of BUF_SIZE - 1 letters. */
+  for (i = 0; i < BUF_SIZE - 1; i++)
+    src[i] = 'a' + i % 26;
+  src[BUF_SIZE - 1] = '\0';
+  memset (dst, 0, 2 * BUF_SIZE);
+
+  switch (op) 
+    {
+    case MEMCPY:
+      memcpy (dst + 5, src + 3, 1001);
+      for (i = 0; i < 1001; i++)
+        if (dst[5 + i] != src[3 + i])
+          fail ("memcpy miscopied byte %zu", i);
+      break;
+    case MEMMOVE:
+      memcpy (dst, src, BUF_SIZE);
+      memmove (dst + 11, dst + 2, 1001);
+      for (i = 0; i < 1001; i++)
+        if (dst[11 + i] != src[2 + i])
+          fail ("memmove miscopied byte %zu", i);
+      break;
+    case MEMSET:
+      memset (dst + 7, 0x5a, 1001);
+      for (i = 0; i < 1010; i++)
+        if (dst[i] != (i >= 7 && i < 1008 ? 0x5a : 0))
+          fail ("memset set byte %zu wrongly", i);
+      break;
+    case MEMCMP:
+      memcpy (dst, src, BUF_SIZE);
+      dst[1000]++;
+      if (memcmp (dst + 1, src + 1, 1001) <= 0)
+        fail ("memcmp missed a difference");
+      dst[1000]--;
+      break;
+    case STRLEN:
+      if (strlen ((char *) src + 5) != BUF_SIZE - 6)
+        fail ("strlen returned the wrong length");
+      break;
+    case STRCHR:
+      if (strchr ((char *) src + 30, 'z') != (char *) src + 51)
+        fail ("strchr found the wrong character");
+      break;
+    default:
+      break;
+    }
+}
@@ -0,0 +1,29 @@
+# -*- perl -*-
+
+# The expected output looks like this, where R varies from run to
+# run:
+#
+# (string-bench) byte loop: R GB/s
+# (string-bench) memcpy: R GB/s
+# (string-bench) memmove: R GB/s
+# (string-bench) memset: R GB/s
+# (string-bench) memcmp: R GB/s
+# (string-bench) strlen: R GB/s
+# (string-bench) strchr: R GB/s
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+for my $name ('byte loop', 'memcpy', 'memmove', 'memset', 'memcmp',
+              'strlen', 'strchr') {
+    fail "$name run did not report its throughput.\n"
+      if !grep (/^\(string-bench\) $name: \d+\.\d\d GB\/s$/, @output);
+}
+
+pass;
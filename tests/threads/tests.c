@@ -29,6 +29,14 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"mutex-bench", test_mutex_bench},
+    {"palloc-bench", test_palloc_bench},
+    {"slab-bench", test_slab_bench},
+    {"malloc-realloc", test_malloc_realloc},
+    {"string-bench", test_string_bench},
+    {"page-zero", test_page_zero},
+    {"hash-bench", test_hash_bench},
+    {"bitmap-bench", test_bitmap_bench},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -23,6 +23,14 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_mutex_bench;
+extern test_func test_palloc_bench;
+extern test_func test_slab_bench;
+extern test_func test_malloc_realloc;
+extern test_func test_string_bench;
+extern test_func test_page_zero;
+extern test_func test_hash_bench;
+extern test_func test_bitmap_bench;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
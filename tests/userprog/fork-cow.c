@@ -0,0 +1,52 @@
+/* Checks that memory written after fork() stays private to the
+   process that wrote it, whether the process writes it directly
+   or the kernel writes it on the process's behalf in read(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+
+static char buf[3 * PAGE];
+
+/* Returns true if the SIZE bytes at P are all C. */
+static bool
+all_bytes (const char *p, size_t size, char c) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void) 
+{
+  pid_t pid;
+  int handle;
+
+  memset (buf, 'p', sizeof buf);
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  if ((pid = fork ("child")) == 0)
+    {
+      buf[0] = 'c';
+      CHECK (read (handle, buf + PAGE, 16) == 16, "child read into buffer");
+      CHECK (!memcmp (buf + PAGE, sample, 16), "child sees data read");
+      CHECK (buf[0] == 'c', "child sees its own write");
+      CHECK (all_bytes (buf + 2 * PAGE, PAGE, 'p'),
+             "child sees parent's data");
+      return;
+    }
+
+  wait (pid);
+  CHECK (all_bytes (buf, 2 * PAGE, 'p'), "parent's data is unchanged");
+  buf[2 * PAGE] = 'q';
+  CHECK (buf[2 * PAGE] == 'q', "parent sees its own write");
+  close (handle);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-cow) begin
+(fork-cow) open "sample.txt"
+(fork-cow) child read into buffer
+(fork-cow) child sees data read
+(fork-cow) child sees its own write
+(fork-cow) child sees parent's data
+(fork-cow) end
+child: exit(0)
+(fork-cow) parent's data is unchanged
+(fork-cow) parent sees its own write
+(fork-cow) end
+fork-cow: exit(0)
+EOF
+pass;
@@ -0,0 +1,26 @@
+/* Checks that memquota() rejects reservations it cannot honor
+   and limits above the current one, and that a child forked
+   under a one-page quota cannot copy its parent's address
+   space. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int pid;
+
+  CHECK (memquota (1, 2) == -1, "reject reserve above limit");
+  CHECK (memquota (SIZE_MAX, SIZE_MAX) == -1, "reject reserving every page");
+  CHECK (memquota (SIZE_MAX, 4) == 0, "reserve 4 pages");
+  CHECK (memquota (1, 0) == 0, "limit to 1 page");
+  CHECK (memquota (2, 0) == -1, "reject raising the limit");
+
+  pid = fork ("child");
+  if (pid == 0)
+    exit (81);
+  CHECK (pid == -1, "fork over quota fails");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(memquota) begin
+(memquota) reject reserve above limit
+(memquota) reject reserving every page
+(memquota) reserve 4 pages
+(memquota) limit to 1 page
+(memquota) reject raising the limit
+child: exit(-1)
+(memquota) fork over quota fails
+(memquota) end
+memquota: exit(0)
+EOF
+pass;
@@ -0,0 +1,73 @@
+/* Forks a process that has touched only some of the pages of its
+   initialized data and its BSS, and checks that the child sees
+   the parent's writes to the touched pages, the original
+   contents of the untouched ones, and that neither process sees
+   the other's later writes. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 16
+
+static uint8_t data[PAGE_COUNT * PAGE_SIZE] =
+  { [0 ... PAGE_COUNT * PAGE_SIZE - 1] = 0x11 };
+static uint8_t bss[PAGE_COUNT * PAGE_SIZE];
+
+/* Returns the first byte of page I of ARRAY. */
+static uint8_t *
+page (uint8_t *array, size_t i)
+{
+  return array + i * PAGE_SIZE;
+}
+
+/* Checks that the even pages of DATA and BSS hold EVEN and the odd
+   pages hold their original contents. */
+static void
+check (const char *who, uint8_t even)
+{
+  size_t i;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    {
+      uint8_t want_data = i % 2 == 0 ? even : 0x11;
+      uint8_t want_bss = i % 2 == 0 ? even : 0;
+
+      if (*page (data, i) != want_data)
+        fail ("%s: data page %zu is 0x%02x", who, i, *page (data, i));
+      if (*page (bss, i) != want_bss)
+        fail ("%s: bss page %zu is 0x%02x", who, i, *page (bss, i));
+    }
+}
+
+/* Writes VALUE to the even pages of DATA and BSS. */
+static void
+write_even (uint8_t value)
+{
+  size_t i;
+
+  for (i = 0; i < PAGE_COUNT; i += 2)
+    *page (data, i) = *page (bss, i) = value;
+}
+
+void
+test_main (void)
+{
+  pid_t pid;
+
+  write_even (0x22);
+  pid = fork ("child");
+  if (pid == 0)
+    {
+      check ("child", 0x22);
+      write_even (0x33);
+      check ("child", 0x33);
+      exit (0);
+    }
+  if (wait (pid) != 0)
+    fail ("child failed");
+  check ("parent", 0x22);
+  msg ("parent's pages intact");
+}
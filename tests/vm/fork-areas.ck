@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-areas) begin
+child: exit(0)
+(fork-areas) parent's pages intact
+(fork-areas) end
+fork-areas: exit(0)
+EOF
+pass;
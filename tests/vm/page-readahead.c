@@ -0,0 +1,47 @@
+/* Reads a 1 MB initialized array, which is loaded lazily from the
+   executable, front to back and then in a scattered order, and
+   checks every byte.  The sequential pass lets the fault handler
+   grow its read-ahead window; the scattered pass makes it shrink
+   the window again.  Either way the data must be intact. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 256
+#define STRIDE 37
+
+/* Every byte is nonzero, so the array is stored in the
+   executable and not in the BSS. */
+static const uint8_t data[PAGE_COUNT * PAGE_SIZE] =
+  { [0 ... PAGE_COUNT * PAGE_SIZE - 1] = 0x5a };
+
+/* Checks page I of DATA. */
+static void
+check_page (size_t i)
+{
+  const uint8_t *page = data + i * PAGE_SIZE;
+  size_t j;
+
+  for (j = 0; j < PAGE_SIZE; j++)
+    if (page[j] != 0x5a)
+      fail ("byte %zu of page %zu is 0x%02x", j, i, page[j]);
+}
+
+void
+test_main (void)
+{
+  size_t i;
+
+  msg ("read %d pages in order", PAGE_COUNT / 2);
+  for (i = 0; i < PAGE_COUNT / 2; i++)
+    check_page (i);
+
+  /* STRIDE is prime to PAGE_COUNT, so this visits every page of
+     the second half exactly once. */
+  msg ("read %d pages out of order", PAGE_COUNT / 2);
+  for (i = 0; i < PAGE_COUNT / 2; i++)
+    check_page (PAGE_COUNT / 2 + i * STRIDE % (PAGE_COUNT / 2));
+}
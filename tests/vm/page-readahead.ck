@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-readahead) begin
+(page-readahead) read 128 pages in order
+(page-readahead) read 128 pages out of order
+(page-readahead) end
+EOF
+pass;
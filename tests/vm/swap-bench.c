@@ -0,0 +1,53 @@
+/* Swap throughput benchmark, after swap-anon and swap-iter.
+   Fills a 20 MB anonymous region, several times larger than the
+   10 MB of memory Pintos runs with, one whole page at a time,
+   then sweeps over it repeatedly, checking and rewriting every
+   page.  Each sweep evicts nearly every page it touches, so the
+   run is dominated by swapping.  The kernel prints the number of
+   pages swapped in and out, and the rate, on the "Swap:" line at
+   power off. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (20 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+#define PASS_COUNT 3
+
+static char big_chunk[CHUNK_SIZE];
+
+/* Returns the byte that page I should hold after pass PASS. */
+static char
+fill_byte (size_t i, int pass)
+{
+  return (char) (i * 31 + pass);
+}
+
+void
+test_main (void)
+{
+  size_t i;
+  int pass;
+
+  msg ("fill %d pages", PAGE_COUNT);
+  for (i = 0; i < PAGE_COUNT; i++)
+    memset (big_chunk + i * PAGE_SIZE, fill_byte (i, 0), PAGE_SIZE);
+
+  for (pass = 1; pass <= PASS_COUNT; pass++)
+    {
+      msg ("pass %d", pass);
+      for (i = 0; i < PAGE_COUNT; i++)
+        {
+          char *page = big_chunk + i * PAGE_SIZE;
+          char want = fill_byte (i, pass - 1);
+
+          if (page[0] != want || page[PAGE_SIZE - 1] != want)
+            fail ("page %zu is inconsistent after pass %d", i, pass - 1);
+          memset (page, fill_byte (i, pass), PAGE_SIZE);
+        }
+    }
+}
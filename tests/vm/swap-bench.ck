@@ -0,0 +1,33 @@
+# -*- perl -*-
+
+# Besides the test's own output, requires the kernel's swap
+# statistics line, printed at power off, which looks like this,
+# where the numbers vary from run to run:
+#
+# Swap: O pages out in B batches, I pages in, R pages/s
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(swap-bench) begin
+(swap-bench) fill 5120 pages
+(swap-bench) pass 1
+(swap-bench) pass 2
+(swap-bench) pass 3
+(swap-bench) end
+EOF
+
+my ($swap) = grep (/^Swap: /, @output);
+fail "Kernel did not report swap throughput.\n"
+  if !defined $swap
+     || $swap !~ /^Swap: (\d+) pages out in \d+ batches, (\d+) pages in, \d+ pages\/s$/;
+fail "Benchmark did not swap pages both out and in.\n"
+  if $1 == 0 || $2 == 0;
+
+pass;
@@ -0,0 +1,203 @@
+#include "threads/buddy.h"
+#include <debug.h>
+#include <stdbool.h>
+
+/* Binary buddy allocator.
+
+   Free pages are kept as blocks of 2**K pages whose first index
+   is a multiple of 2**K, one free list per order K.  An
+   allocation of N pages takes the smallest block of at least N
+   pages, splitting larger blocks in half as needed, and gives
+   back the unused tail.  Freeing a block merges it with its
+   "buddy", the other half of the next larger aligned block,
+   for as long as that buddy is free too.  Both take O(log n)
+   time.
+
+   Free lists are threaded through a bookkeeping array instead
+   of through the free pages themselves, so free pages are
+   never touched: they need not be mapped, and their contents
+   survive.  The caller provides the array, buddy_meta_size()
+   bytes long, and must serialize all calls on one struct
+   buddy. */
+
+/* Bookkeeping for one page. */
+struct buddy_page {
+	uint32_t next;              /* Next free block of same order. */
+	uint32_t prev;              /* Previous free block of same order. */
+	uint8_t order;              /* 1 + order if first page of a free
+	                               block, otherwise 0. */
+};
+
+/* End of a free list. */
+#define NIL UINT32_MAX
+
+/* Returns the number of bytes of bookkeeping needed for a
+   buddy allocator over PAGE_CNT pages. */
+size_t
+buddy_meta_size (size_t page_cnt) {
+	return page_cnt * sizeof (struct buddy_page);
+}
+
+/* Initializes B to manage PAGE_CNT pages, all of them in use,
+   keeping its bookkeeping in META. */
+void
+buddy_init (struct buddy *b, size_t page_cnt, void *meta) {
+	ASSERT (page_cnt < NIL);
+
+	b->page_cnt = page_cnt;
+	b->free_cnt = 0;
+	b->pages = meta;
+	b->nonempty = 0;
+	for (int k = 0; k < BUDDY_ORDERS; k++)
+		b->heads[k] = NIL;
+	for (size_t i = 0; i < page_cnt; i++)
+		b->pages[i].order = 0;
+}
+
+/* Adds the block of order K at IDX to its free list. */
+static void
+push_block (struct buddy *b, size_t idx, int k) {
+	struct buddy_page *p = &b->pages[idx];
+
+	p->order = k + 1;
+	p->prev = NIL;
+	p->next = b->heads[k];
+	if (p->next != NIL)
+		b->pages[p->next].prev = idx;
+	b->heads[k] = idx;
+	b->nonempty |= 1u << k;
+}
+
+/* Removes the free block of order K at IDX from its free list. */
+static void
+remove_block (struct buddy *b, size_t idx, int k) {
+	struct buddy_page *p = &b->pages[idx];
+
+	ASSERT (p->order == k + 1);
+	if (p->prev != NIL)
+		b->pages[p->prev].next = p->next;
+	else
+		b->heads[k] = p->next;
+	if (p->next != NIL)
+		b->pages[p->next].prev = p->prev;
+	if (b->heads[k] == NIL)
+		b->nonempty &= ~(1u << k);
+	p->order = 0;
+}
+
+/* Frees the block of order K at IDX, merging it with its buddy
+   as far as possible. */
+static void
+free_block (struct buddy *b, size_t idx, int k) {
+	while (k + 1 < BUDDY_ORDERS) {
+		size_t buddy = idx ^ ((size_t) 1 << k);
+
+		if (buddy + ((size_t) 1 << k) > b->page_cnt
+				|| b->pages[buddy].order != k + 1)
+			break;
+		remove_block (b, buddy, k);
+		if (buddy < idx)
+			idx = buddy;
+		k++;
+	}
+	push_block (b, idx, k);
+}
+
+/* Frees the PAGE_CNT pages starting at PAGE_IDX, which need not
+   be a single block: the range is split into the largest
+   aligned blocks it contains. */
+static void
+free_range (struct buddy *b, size_t idx, size_t cnt) {
+	while (cnt > 0) {
+		int k = 0;
+
+		while (k + 1 < BUDDY_ORDERS
+				&& (idx & ((size_t) 1 << k)) == 0
+				&& ((size_t) 2 << k) <= cnt)
+			k++;
+		free_block (b, idx, k);
+		idx += (size_t) 1 << k;
+		cnt -= (size_t) 1 << k;
+	}
+}
+
+/* Allocates PAGE_CNT contiguous pages from B and returns the
+   index of the first, or BUDDY_ERROR if no free block is large
+   enough. */
+size_t
+buddy_alloc (struct buddy *b, size_t page_cnt) {
+	uint32_t fits;
+	size_t idx;
+	int k = 0, j;
+
+	ASSERT (page_cnt > 0);
+	while (((size_t) 1 << k) < page_cnt)
+		if (++k >= BUDDY_ORDERS)
+			return BUDDY_ERROR;
+
+	/* Smallest non-empty order at least K. */
+	fits = b->nonempty & ~((1u << k) - 1);
+	if (fits == 0)
+		return BUDDY_ERROR;
+	j = __builtin_ctz (fits);
+	idx = b->heads[j];
+	remove_block (b, idx, j);
+
+	/* Split down to order K, then give back the tail we do not
+	   need. */
+	while (j > k) {
+		j--;
+		push_block (b, idx + ((size_t) 1 << j), j);
+	}
+	free_range (b, idx + page_cnt, ((size_t) 1 << k) - page_cnt);
+
+	b->free_cnt -= page_cnt;
+	return idx;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX to B.  They
+   need not have been allocated as a single group. */
+void
+buddy_free (struct buddy *b, size_t page_idx, size_t page_cnt) {
+	ASSERT (page_idx + page_cnt <= b->page_cnt);
+
+	free_range (b, page_idx, page_cnt);
+	b->free_cnt += page_cnt;
+}
+
+/* Takes the PAGE_CNT pages starting at PAGE_IDX, all of which
+   must be free, out of B, splitting the free blocks that hold
+   them and giving back the rest of those blocks. */
+void
+buddy_claim (struct buddy *b, size_t page_idx, size_t page_cnt) {
+	size_t end = page_idx + page_cnt;
+
+	ASSERT (end <= b->page_cnt);
+	while (page_idx < end) {
+		size_t start = 0, block_end, claim_end;
+		int k;
+
+		/* Find the free block that holds PAGE_IDX. */
+		for (k = 0; k < BUDDY_ORDERS; k++) {
+			start = page_idx & ~(((size_t) 1 << k) - 1);
+			if (b->pages[start].order == k + 1)
+				break;
+		}
+		ASSERT (k < BUDDY_ORDERS);
+		remove_block (b, start, k);
+
+		/* Give back its pages on either side of the claim. */
+		block_end = start + ((size_t) 1 << k);
+		claim_end = block_end < end ? block_end : end;
+		free_range (b, start, page_idx - start);
+		free_range (b, claim_end, block_end - claim_end);
+		page_idx = claim_end;
+	}
+	b->free_cnt -= page_cnt;
+}
+
+/* Returns the number of free pages in B. */
+size_t
+buddy_free_cnt (const struct buddy *b) {
+	return b->free_cnt;
+}
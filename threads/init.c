@@ -17,9 +17,11 @@
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
+#include "threads/memtrack.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -57,6 +59,10 @@ static void paging_init (uint64_t mem_end);
 static char **read_command_line (void);
 static char **parse_options (char **argv);
 static void run_actions (char **argv);
+static void run_schedstat (char **argv);
+#ifdef MEMTRACK
+static void run_memstat (char **argv);
+#endif
 static void usage (void);
 
 static void print_stats (void);
@@ -82,8 +88,10 @@ main (void) {
 	console_init ();
 
 	/* Initialize memory system. */
+	memtrack_init ();
 	mem_end = palloc_init ();
 	malloc_init ();
+	kmem_cache_init ();
 	paging_init (mem_end);
 
 #ifdef USERPROG
@@ -220,9 +228,17 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-buddy"))
+			palloc_buddy = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
+		else if (!strcmp (name, "-uq"))
+			user_page_quota = atoi (value);
+		else if (!strcmp (name, "-ur"))
+			user_reserve_max = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
 #endif
@@ -251,6 +267,20 @@ run_task (char **argv) {
 	printf ("Execution of '%s' complete.\n", task);
 }
 
+/* Prints the scheduler latency counters gathered so far. */
+static void
+run_schedstat (char **argv UNUSED) {
+	thread_print_sched_stats ();
+}
+
+#ifdef MEMTRACK
+/* Prints the memory held by each allocation call site. */
+static void
+run_memstat (char **argv UNUSED) {
+	memtrack_dump ();
+}
+#endif
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -265,6 +295,10 @@ run_actions (char **argv) {
 	/* Table of supported actions. */
 	static const struct action actions[] = {
 		{"run", 2, run_task},
+		{"schedstat", 1, run_schedstat},
+#ifdef MEMTRACK
+		{"memstat", 1, run_memstat},
+#endif
 #ifdef FILESYS
 		{"ls", 1, fsutil_ls},
 		{"cat", 2, fsutil_cat},
@@ -310,6 +344,10 @@ usage (void) {
 			"  run 'PROG [ARG...]' Run PROG and wait for it to complete.\n"
 #else
 			"  run TEST           Run TEST.\n"
+#endif
+			"  schedstat          Print scheduler latency counters.\n"
+#ifdef MEMTRACK
+			"  memstat            Print memory held by each call site.\n"
 #endif
 #ifdef FILESYS
 			"  ls                 List files in the root directory.\n"
@@ -325,8 +363,12 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -tickless          Stop the periodic timer tick while idle.\n"
+			"  -buddy             Use the buddy page allocator.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+			"  -uq=COUNT          Limit each process to COUNT user pages.\n"
+			"  -ur=COUNT          Let processes reserve COUNT user pages in all.\n"
 #endif
 			);
 	power_off ();
@@ -353,6 +395,9 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	malloc_print_stats ();
+	kmem_cache_print_stats ();
+	memtrack_dump ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -361,4 +406,7 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_anon_print_stats ();
+#endif
 }
@@ -103,6 +103,12 @@ static const char *intr_names[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* TSC value when interrupts were last turned off, by
+   intr_disable() or by entry to an interrupt handler, or 0 if
+   that interrupts-off section has already been accounted for by
+   intr_off_end(). */
+static uint64_t intr_off_since;
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -137,6 +143,9 @@ intr_enable (void) {
 	enum intr_level old_level = intr_get_level ();
 	ASSERT (!intr_context ());
 
+	if (old_level == INTR_OFF)
+		intr_off_end ();
+
 	/* Enable interrupts by setting the interrupt flag.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -156,9 +165,26 @@ intr_disable (void) {
 	   Hardware Interrupts". */
 	asm volatile ("cli" : : : "memory");
 
+	if (old_level == INTR_ON)
+		intr_off_since = rdtsc ();
+
 	return old_level;
 }
 
+/* Closes the current interrupts-off section, if one is open, and
+   charges its length to the running thread.  Called just before
+   interrupts are turned back on; paths that re-enable interrupts
+   without intr_enable(), such as `sti; hlt' in the idle loop,
+   call it themselves. */
+void
+intr_off_end (void) {
+	if (intr_off_since != 0) {
+		uint64_t cycles = rdtsc () - intr_off_since;
+		intr_off_since = 0;
+		thread_account_intr_off (cycles);
+	}
+}
+
 /* Initializes the interrupt system. */
 void
 intr_init (void) {
@@ -338,6 +364,8 @@ intr_handler (struct intr_frame *frame) {
 	   and they need to be acknowledged on the PIC (see below).
 	   An external interrupt handler cannot sleep. */
 	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+	if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+		intr_off_since = rdtsc ();
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (!intr_context ());
@@ -372,6 +400,10 @@ intr_handler (struct intr_frame *frame) {
 		if (yield_on_return)
 			thread_yield ();
 	}
+
+	/* iretq turns interrupts back on for the interrupted code. */
+	if (frame->eflags & FLAG_IF)
+		intr_off_end ();
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
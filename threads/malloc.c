@@ -5,8 +5,11 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/memtrack.h"
 #include "threads/palloc.h"
+#include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
@@ -28,6 +31,14 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
+   In front of each descriptor, every thread keeps a small
+   "magazine" of free blocks of that size.  malloc() and free()
+   use the running thread's magazine without locking, and only
+   take the descriptor's lock to refill or drain MAG_BATCH blocks
+   at a time.  Blocks in a magazine still count as in use by
+   their arena, so an arena is only released once they have been
+   drained back.  A thread's magazines are drained when it exits.
+
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
@@ -39,7 +50,7 @@ struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
-	struct lock lock;           /* Lock. */
+	struct mutex lock;          /* Lock. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -54,15 +65,32 @@ struct arena {
 
 /* Free block. */
 struct block {
-	struct list_elem free_elem; /* Free list element. */
+	union {
+		struct list_elem free_elem; /* Free list element. */
+		struct block *mag_next;     /* Next block in a magazine. */
+	};
 };
 
 /* Our set of descriptors. */
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Magazine capacity, and number of blocks moved per refill or
+   drain. */
+#define MAG_SIZE 16
+#define MAG_BATCH 8
+
+/* Magazine statistics.  Updated without locking, so approximate. */
+static long long mag_hits;      /* Served by a magazine. */
+static long long mag_misses;    /* Needed a refill or drain. */
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static bool mag_refill (struct desc *, struct malloc_mag *);
+static void mag_drain (struct desc *, struct malloc_mag *, unsigned cnt);
+static bool realloc_in_place (void *, size_t new_size);
+static void *malloc_block (size_t);
+static size_t block_size (void *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -75,14 +103,24 @@ malloc_init (void) {
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
-		lock_init (&d->lock);
+		mutex_init (&d->lock);
 	}
+	ASSERT (desc_cnt == MALLOC_CLASS_CNT);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) {
+	void *p = malloc_block (size);
+	if (p != NULL)
+		memtrack_alloc (MEMTRACK_MALLOC, MEMTRACK_SITE, p, block_size (p));
+	return p;
+}
+
+/* Does the work of malloc(). */
+static void *
+malloc_block (size_t size) {
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
@@ -112,7 +150,31 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
+	/* Take a block from our magazine, refilling it if empty. */
+	ASSERT (!intr_context ());
+	struct malloc_mag *m = &thread_current ()->mags[d - descs];
+	if (m->cnt != 0)
+		mag_hits++;
+	else {
+		mag_misses++;
+		if (!mag_refill (d, m))
+			return NULL;
+	}
+	b = m->head;
+	m->head = b->mag_next;
+	m->cnt--;
+	return b;
+}
+
+/* Moves up to MAG_BATCH blocks from D into empty magazine M,
+   creating a new arena if D has no free blocks.  Returns false
+   if memory is not available. */
+static bool
+mag_refill (struct desc *d, struct malloc_mag *m) {
+	struct arena *a;
+
+	ASSERT (m->cnt == 0);
+	mutex_acquire (&d->lock);
 
 	/* If the free list is empty, create a new arena. */
 	if (list_empty (&d->free_list)) {
@@ -121,8 +183,8 @@ malloc (size_t size) {
 		/* Allocate a page. */
 		a = palloc_get_page (0);
 		if (a == NULL) {
-			lock_release (&d->lock);
-			return NULL;
+			mutex_release (&d->lock);
+			return false;
 		}
 
 		/* Initialize arena and add its blocks to the free list. */
@@ -135,12 +197,68 @@ malloc (size_t size) {
 		}
 	}
 
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
-	lock_release (&d->lock);
-	return b;
+	/* Move blocks from the free list into the magazine. */
+	while (m->cnt < MAG_BATCH && !list_empty (&d->free_list)) {
+		struct block *b = list_entry (list_pop_front (&d->free_list),
+				struct block, free_elem);
+		a = block_to_arena (b);
+		a->free_cnt--;
+		b->mag_next = m->head;
+		m->head = b;
+		m->cnt++;
+	}
+	mutex_release (&d->lock);
+	return true;
+}
+
+/* Returns CNT blocks from magazine M to D's free list, releasing
+   any arena that becomes entirely unused. */
+static void
+mag_drain (struct desc *d, struct malloc_mag *m, unsigned cnt) {
+	ASSERT (cnt <= m->cnt);
+	mutex_acquire (&d->lock);
+	while (cnt-- > 0) {
+		struct block *b = m->head;
+		struct arena *a = block_to_arena (b);
+
+		m->head = b->mag_next;
+		m->cnt--;
+
+		/* Add block to free list. */
+		list_push_front (&d->free_list, &b->free_elem);
+
+		/* If the arena is now entirely unused, free it. */
+		if (++a->free_cnt >= d->blocks_per_arena) {
+			size_t i;
+
+			ASSERT (a->free_cnt == d->blocks_per_arena);
+			for (i = 0; i < d->blocks_per_arena; i++) {
+				struct block *b = arena_to_block (a, i);
+				list_remove (&b->free_elem);
+			}
+			palloc_free_page (a);
+		}
+	}
+	mutex_release (&d->lock);
+}
+
+/* Returns all blocks in the running thread's magazines to their
+   descriptors.  Called by thread_exit(). */
+void
+malloc_thread_exit (void) {
+	struct thread *t = thread_current ();
+	size_t i;
+
+	for (i = 0; i < desc_cnt; i++)
+		if (t->mags[i].cnt != 0)
+			mag_drain (&descs[i], &t->mags[i], t->mags[i].cnt);
+}
+
+/* Prints magazine statistics. */
+void
+malloc_print_stats (void) {
+	printf ("Malloc: %lld magazine hits, %lld misses\n",
+			mag_hits, mag_misses);
 }
 
 /* Allocates and return A times B bytes initialized to zeroes.
@@ -156,9 +274,11 @@ calloc (size_t a, size_t b) {
 		return NULL;
 
 	/* Allocate and zero memory. */
-	p = malloc (size);
-	if (p != NULL)
+	p = malloc_block (size);
+	if (p != NULL) {
 		memset (p, 0, size);
+		memtrack_alloc (MEMTRACK_MALLOC, MEMTRACK_SITE, p, block_size (p));
+	}
 
 	return p;
 }
@@ -173,19 +293,35 @@ block_size (void *block) {
 	return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
 }
 
+/* Returns the number of bytes that may be used in BLOCK, which
+   must have been allocated with malloc(), calloc(), or
+   realloc().  This is at least the size that was requested.
+   Returns 0 if BLOCK is a null pointer. */
+size_t
+malloc_usable_size (void *block) {
+	return block != NULL ? block_size (block) : 0;
+}
+
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
    moving it in the process.
    If successful, returns the new block; on failure, returns a
    null pointer.
    A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
-   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK).
+   OLD_BLOCK is returned unmoved if it is already big enough, or
+   if it is a big block whose following pages are free. */
 void *
 realloc (void *old_block, size_t new_size) {
 	if (new_size == 0) {
 		free (old_block);
 		return NULL;
-	} else {
-		void *new_block = malloc (new_size);
+	} else if (old_block != NULL && realloc_in_place (old_block, new_size))
+		return old_block;
+	else {
+		void *new_block = malloc_block (new_size);
+		if (new_block != NULL)
+			memtrack_alloc (MEMTRACK_MALLOC, MEMTRACK_SITE, new_block,
+					block_size (new_block));
 		if (old_block != NULL && new_block != NULL) {
 			size_t old_size = block_size (old_block);
 			size_t min_size = new_size < old_size ? new_size : old_size;
@@ -196,6 +332,32 @@ realloc (void *old_block, size_t new_size) {
 	}
 }
 
+/* Tries to resize BLOCK to NEW_SIZE bytes without moving it.
+   A normal block can only be resized within its block size.  A
+   big block gives back whole pages it no longer needs, and grows
+   by taking the pages after it if they are free.  Returns true
+   if successful. */
+static bool
+realloc_in_place (void *block, size_t new_size) {
+	struct arena *a = block_to_arena (block);
+	size_t page_cnt;
+
+	if (a->desc != NULL)
+		return new_size <= a->desc->block_size;
+
+	page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+	if (page_cnt < a->free_cnt)
+		palloc_free_multiple ((uint8_t *) a + page_cnt * PGSIZE,
+				a->free_cnt - page_cnt);
+	else if (page_cnt > a->free_cnt
+			&& !palloc_extend (a, a->free_cnt, page_cnt))
+		return false;
+	a->free_cnt = page_cnt;
+	memtrack_resize (a, page_cnt * PGSIZE);
+	memtrack_resize (block, block_size (block));
+	return true;
+}
+
 /* Frees block P, which must have been previously allocated with
    malloc(), calloc(), or realloc(). */
 void
@@ -205,6 +367,8 @@ free (void *p) {
 		struct arena *a = block_to_arena (b);
 		struct desc *d = a->desc;
 
+		memtrack_free (p);
+
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
 
@@ -213,24 +377,19 @@ free (void *p) {
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+			/* Put the block in our magazine, first draining a
+			   batch if it is full. */
+			ASSERT (!intr_context ());
+			struct malloc_mag *m = &thread_current ()->mags[d - descs];
+			if (m->cnt < MAG_SIZE)
+				mag_hits++;
+			else {
+				mag_misses++;
+				mag_drain (d, m, MAG_BATCH);
 			}
-
-			lock_release (&d->lock);
+			b->mag_next = m->head;
+			m->head = b;
+			m->cnt++;
 		} else {
 			/* It's a big block.  Free its pages. */
 			palloc_free_multiple (a, a->free_cnt);
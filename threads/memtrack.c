@@ -0,0 +1,242 @@
+#include "threads/memtrack.h"
+#ifdef MEMTRACK
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/synch.h"
+
+/* Kernel memory accounting.
+
+   Built with "make MEMTRACK=N", palloc, malloc and the slab
+   caches report each allocation here along with its call site,
+   the address their caller will return to.  We remember which
+   site every live allocation came from and keep running totals
+   per site, so that memtrack_dump() can show who holds how much
+   memory.  A site that keeps growing is a leak.  Pass the
+   addresses to the `backtrace' utility to turn them into source
+   lines.
+
+   The three kinds are counted separately: pages held by malloc's
+   arenas and by slab caches show up as palloc allocations made
+   from inside malloc.c and slab.c, and the blocks and objects
+   carved out of them as malloc and slab allocations made by
+   their real callers.
+
+   With N = 1 every allocation is tracked, which costs a hash
+   table insertion and deletion under a spinlock per allocation.
+   With N > 1 only allocations whose address hashes to 0 modulo
+   N are tracked, so the other (N - 1) / N skip the table and the
+   lock entirely, and the totals are scaled by N when printed.
+   Because the choice depends only on the address, free() knows
+   without a lookup whether a block was tracked.
+
+   Both tables are fixed-size arrays, since the allocators
+   cannot call themselves.  Allocations that find the table full
+   are counted and otherwise ignored. */
+
+/* Sampling period: track one allocation in MEMTRACK. */
+#define SAMPLE_PERIOD MEMTRACK
+
+/* Number of distinct call sites (a power of 2). */
+#define SITE_CNT 512
+
+/* Number of live allocations tracked at once (a power of 2). */
+#define SLOT_CNT 16384
+
+/* A call site. */
+struct site {
+	const void *pc;             /* Return address, or null if unused. */
+	enum memtrack_kind kind;    /* Allocator called. */
+	size_t live_cnt;            /* Allocations not yet freed. */
+	size_t live_bytes;          /* Bytes not yet freed. */
+	long long allocs;           /* Total allocations. */
+};
+
+/* A live allocation. */
+struct slot {
+	void *p;                    /* Address, or null if unused. */
+	size_t size;                /* Size in bytes. */
+	struct site *site;          /* Call site charged. */
+};
+
+static struct site sites[SITE_CNT];
+static struct slot slots[SLOT_CNT];
+static struct spinlock memtrack_lock;   /* Protects the above. */
+static long long dropped;               /* Allocations not tracked. */
+
+/* Returns a hash of pointer P. */
+static inline uint64_t
+hash_ptr (const void *p) {
+	return ((uint64_t) p >> 4) * 0x9e3779b97f4a7c15ULL;
+}
+
+/* Returns true if allocation P is one we track. */
+static inline bool
+sampled (const void *p) {
+	return SAMPLE_PERIOD <= 1 || (hash_ptr (p) >> 32) % SAMPLE_PERIOD == 0;
+}
+
+/* Returns the slot holding P, or the empty slot where P would
+   go.  Returns a null pointer if P is not present and the
+   table is full. */
+static struct slot *
+find_slot (const void *p) {
+	size_t i = (hash_ptr (p) >> 40) & (SLOT_CNT - 1);
+	size_t n;
+
+	for (n = 0; n < SLOT_CNT; n++, i = (i + 1) & (SLOT_CNT - 1))
+		if (slots[i].p == p || slots[i].p == NULL)
+			return &slots[i];
+	return NULL;
+}
+
+/* Returns the entry for call site PC of allocator KIND, creating
+   it if necessary, or a null pointer if the table is full. */
+static struct site *
+find_site (enum memtrack_kind kind, const void *pc) {
+	size_t i = (hash_ptr (pc) >> 40) & (SITE_CNT - 1);
+	size_t n;
+
+	for (n = 0; n < SITE_CNT; n++, i = (i + 1) & (SITE_CNT - 1)) {
+		struct site *s = &sites[i];
+		if (s->pc == NULL) {
+			s->pc = pc;
+			s->kind = kind;
+			return s;
+		}
+		if (s->pc == pc && s->kind == kind)
+			return s;
+	}
+	return NULL;
+}
+
+/* Removes the slot S from the table, moving later members of
+   its probe sequence back so that lookups still find them. */
+static void
+remove_slot (struct slot *s) {
+	size_t i = s - slots;
+	size_t j = i;
+
+	for (;;) {
+		size_t home;
+
+		j = (j + 1) & (SLOT_CNT - 1);
+		if (slots[j].p == NULL)
+			break;
+
+		/* Move slot J into the hole at I unless its home lies
+		   cyclically in (I, J]. */
+		home = (hash_ptr (slots[j].p) >> 40) & (SLOT_CNT - 1);
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+		slots[i] = slots[j];
+		i = j;
+	}
+	slots[i].p = NULL;
+}
+
+/* Initializes memory accounting. */
+void
+memtrack_init (void) {
+	spin_lock_init (&memtrack_lock);
+}
+
+/* Records that SITE obtained SIZE bytes at P from allocator KIND. */
+void
+memtrack_alloc (enum memtrack_kind kind, const void *site, void *p,
+		size_t size) {
+	struct slot *slot;
+	struct site *s;
+
+	if (p == NULL || !sampled (p))
+		return;
+
+	spin_lock (&memtrack_lock);
+	slot = find_slot (p);
+	s = find_site (kind, site);
+	if (slot != NULL && slot->p == NULL && s != NULL) {
+		slot->p = p;
+		slot->size = size;
+		slot->site = s;
+		s->live_cnt++;
+		s->live_bytes += size;
+		s->allocs++;
+	} else
+		dropped++;
+	spin_unlock (&memtrack_lock);
+}
+
+/* Records that allocation P now has SIZE bytes, still charged
+   to the site that made it. */
+void
+memtrack_resize (void *p, size_t size) {
+	struct slot *slot;
+
+	if (p == NULL || !sampled (p))
+		return;
+
+	spin_lock (&memtrack_lock);
+	slot = find_slot (p);
+	if (slot != NULL && slot->p == p) {
+		slot->site->live_bytes += size - slot->size;
+		slot->size = size;
+	}
+	spin_unlock (&memtrack_lock);
+}
+
+/* Records that allocation P was freed. */
+void
+memtrack_free (void *p) {
+	struct slot *slot;
+
+	if (p == NULL || !sampled (p))
+		return;
+
+	spin_lock (&memtrack_lock);
+	slot = find_slot (p);
+	if (slot != NULL && slot->p == p) {
+		slot->site->live_cnt--;
+		slot->site->live_bytes -= slot->size;
+		remove_slot (slot);
+	}
+	spin_unlock (&memtrack_lock);
+}
+
+/* Prints the memory held by each call site that still holds
+   any. */
+void
+memtrack_dump (void) {
+	static const char *kind_names[] = { "palloc", "malloc", "slab" };
+	size_t live_bytes[3] = { 0, 0, 0 };
+	size_t i;
+
+	printf ("Memory held by call site");
+	if (SAMPLE_PERIOD > 1)
+		printf (" (estimated from 1 in %d allocations)", SAMPLE_PERIOD);
+	printf (":\n");
+
+	/* Copy out each site under the lock, but print without it,
+	   since printing may sleep. */
+	for (i = 0; i < SITE_CNT; i++) {
+		struct site s;
+
+		spin_lock (&memtrack_lock);
+		s = sites[i];
+		spin_unlock (&memtrack_lock);
+		if (s.pc == NULL || s.live_cnt == 0)
+			continue;
+		live_bytes[s.kind] += s.live_bytes;
+		printf ("  %s %p: %zu live, %zu bytes, %lld allocations\n",
+				kind_names[s.kind], s.pc, s.live_cnt * SAMPLE_PERIOD,
+				s.live_bytes * SAMPLE_PERIOD, s.allocs * SAMPLE_PERIOD);
+	}
+	printf ("Memory held: %zu bytes in pages, %zu bytes in malloc blocks, "
+			"%zu bytes in slab objects\n",
+			live_bytes[MEMTRACK_PALLOC] * SAMPLE_PERIOD,
+			live_bytes[MEMTRACK_MALLOC] * SAMPLE_PERIOD,
+			live_bytes[MEMTRACK_SLAB] * SAMPLE_PERIOD);
+	if (dropped != 0)
+		printf ("Memory tracking: %lld allocations not tracked\n", dropped);
+}
+#endif /* MEMTRACK */
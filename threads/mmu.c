@@ -313,3 +313,87 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 			invlpg ((uint64_t) vpage);
 	}
 }
+
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PML4, keeping its other bits. */
+void
+pml4_set_writable (uint64_t *pml4, const void *vpage, bool writable) {
+	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	if (pte) {
+		if (writable)
+			*pte |= PTE_W;
+		else
+			*pte &= ~(uint64_t) PTE_W;
+
+		if (rcr3 () == vtop (pml4))
+			invlpg ((uint64_t) vpage);
+	}
+}
+
+/* Maps user virtual page UPAGE in DST to the same frame it is
+ * mapped to in SRC, charging the frame to the running thread.
+ * If the page is writable in SRC, it becomes read-only and
+ * copy-on-write in both, and the first write to it through
+ * either page table copies it; see pml4_break_cow().
+ * Returns false if UPAGE is not mapped in SRC, the frame
+ * cannot be shared, or memory allocation failed. */
+bool
+pml4_share_page (uint64_t *dst, uint64_t *src, void *upage) {
+	uint64_t *src_pte, *dst_pte;
+	void *kpage;
+
+	ASSERT (pg_ofs (upage) == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (dst != base_pml4 && src != base_pml4);
+
+	src_pte = pml4e_walk (src, (uint64_t) upage, false);
+	if (src_pte == NULL || (*src_pte & PTE_P) == 0)
+		return false;
+	dst_pte = pml4e_walk (dst, (uint64_t) upage, true);
+	if (dst_pte == NULL)
+		return false;
+
+	kpage = ptov (PTE_ADDR (*src_pte));
+	if (!palloc_share_page (kpage))
+		return false;
+
+	if (*src_pte & PTE_W) {
+		*src_pte = (*src_pte & ~PTE_W) | PTE_COW;
+		if (rcr3 () == vtop (src))
+			invlpg ((uint64_t) upage);
+	}
+	*dst_pte = vtop (kpage) | PTE_P | PTE_U | (*src_pte & PTE_COW);
+	return true;
+}
+
+/* Gives PML4 a writable frame of its own for copy-on-write page
+ * UPAGE, after a write to it faulted.  Copies the frame unless
+ * every other page table that shared it has since let it go.
+ * Returns false if UPAGE is not a copy-on-write page in PML4 or
+ * no frame is available for the copy. */
+bool
+pml4_break_cow (uint64_t *pml4, void *upage) {
+	uint64_t *pte;
+	void *kpage;
+
+	upage = pg_round_down (upage);
+	ASSERT (is_user_vaddr (upage));
+
+	pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	if (pte == NULL || (*pte & (PTE_P | PTE_COW)) != (PTE_P | PTE_COW))
+		return false;
+
+	kpage = ptov (PTE_ADDR (*pte));
+	if (palloc_page_holders (kpage) > 1) {
+		void *copy = palloc_get_page (PAL_USER);
+		if (copy == NULL)
+			return false;
+		page_copy (copy, kpage);
+		*pte = vtop (copy) | (*pte & PTE_FLAGS);
+		palloc_free_page (kpage);
+	}
+	*pte = (*pte & ~PTE_COW) | PTE_W;
+	if (rcr3 () == vtop (pml4))
+		invlpg ((uint64_t) upage);
+	return true;
+}
@@ -7,9 +7,12 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/buddy.h"
 #include "threads/init.h"
 #include "threads/loader.h"
+#include "threads/memtrack.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,24 +27,114 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Free pages are found by a first-fit scan of each pool's
+   bitmap, or, with the "-buddy" option, by a buddy allocator
+   (buddy.c) that takes O(log n) time however fragmented the pool
+   is.  The bitmap is kept up to date in both modes and checks
+   the buddy allocator's answers.
+
+   User pool pages are also charged to the thread that allocates
+   them and credited to the thread that frees them, which is
+   always the process that used them.  Each process may hold at
+   most its quota's limit of them, so one memory-hungry process
+   cannot take the whole pool, and may have some reserved: other
+   processes may only allocate past their own reservations from
+   the free pages that nobody has reserved.  A process at its
+   limit gets null pointers even if the pool has free pages, and
+   is expected to reclaim from its own pages.  A process may only
+   lower its limit, and all reservations together may not exceed
+   user_reserve_max pages, so no process can reserve its way
+   around the limits of the others.
+
+   A reservation is only worth the free pages behind it, so the
+   count of reserved free pages never exceeds the count of free
+   pages.  When a process drops below its reservation without
+   freeing a page, as when another holder keeps a shared page or
+   an evicting process takes a page over, only as much of its
+   reservation is counted again as unreserved free pages allow.
+
+   A user pool page may be mapped by several processes at once,
+   as fork() does with copy-on-write pages.  Each process that
+   maps it is charged for it, and it returns to the pool only
+   when the last of them frees it.
+
+   Each pool also keeps a stack of up to ZERO_POOL_SIZE pages that
+   the idle thread has already zeroed, so that a single-page
+   PAL_ZERO allocation is usually just a pop.  The idle thread
+   finds the pages to zero on a second stack, of single pages
+   that palloc_free_page() parked there instead of returning
+   them to the bitmap, so it never has to take the pool's lock,
+   which it could hold while preempted with no way to be
+   scheduled back.  Pages on both stacks are marked used in the
+   bitmap, and are given back if an allocation would otherwise
+   fail. */
+
+/* Number of pre-zeroed pages each pool keeps. */
+#define ZERO_POOL_SIZE 64
 
 /* A memory pool. */
 struct pool {
 	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+
+	struct spinlock buddy_lock;     /* Protects buddy and used_map. */
+	struct buddy buddy;             /* Free blocks, if palloc_buddy. */
+
+	struct spinlock zero_lock;      /* Protects the members below. */
+	void *zeroed[ZERO_POOL_SIZE];   /* Pre-zeroed pages. */
+	size_t zero_cnt;                /* Number of pages in zeroed[]. */
+	void *dirty[ZERO_POOL_SIZE];    /* Freed pages waiting to be zeroed. */
+	size_t dirty_cnt;               /* Number of pages in dirty[]. */
+
+	uint16_t *shares;               /* Holders of each page beyond the
+	                                   first, in the user pool only. */
 };
 
+/* If true, allocate with the buddy allocator instead of scanning
+   the bitmap.  Controlled by kernel command-line option
+   "-buddy". */
+bool palloc_buddy;
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
+
+/* Default per-process limit on user pool pages.  Controlled by
+   kernel command-line option "-uq". */
+size_t user_page_quota = SIZE_MAX;
+
+/* Most user pool pages all processes together may reserve.
+   Controlled by kernel command-line option "-ur"; half of the
+   user pool by default. */
+size_t user_reserve_max = SIZE_MAX;
+
+/* User pool quota accounting. */
+static struct spinlock quota_lock;      /* Protects the members below,
+                                           every user_quota, and the
+                                           user pool's shares[]. */
+static size_t user_free_cnt;            /* Free user pool pages. */
+static size_t reserved_unused;          /* Reserved but not yet held. */
+static size_t reserved_total;           /* Sum of every reservation. */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void *get_multiple (enum palloc_flags, size_t page_cnt,
+		const void *site);
+static bool quota_charge (size_t page_cnt);
+static void reserve_adjust (size_t old_unused, size_t new_unused);
+static void quota_credit (size_t page_cnt, bool freed);
+static bool drop_share (size_t page_idx);
+static size_t take_pages (struct pool *, size_t page_cnt);
+static void release_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void *zero_pool_pop (struct pool *);
+static bool zero_pool_park (struct pool *, void *page);
+static bool zero_pool_drain (struct pool *);
 
 /* multiboot info */
 struct multiboot_info {
@@ -224,11 +317,19 @@ split:
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				if (palloc_buddy)
+					buddy_free (&pool->buddy, page_idx, page_cnt);
+				if (pool == &user_pool)
+					user_free_cnt += page_cnt;
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				if (palloc_buddy)
+					buddy_free (&pool->buddy, page_idx, page_cnt);
+				if (pool == &user_pool)
+					user_free_cnt += page_cnt;
 			}
 		}
 	}
@@ -243,6 +344,7 @@ palloc_init (void) {
 	struct area base_mem = { .size = 0 };
 	struct area ext_mem = { .size = 0 };
 
+	spin_lock_init (&quota_lock);
 	resolve_area_info (&base_mem, &ext_mem);
 	printf ("Pintos booting with: \n");
 	printf ("\tbase_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
@@ -250,6 +352,8 @@ palloc_init (void) {
 	printf ("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
 		  ext_mem.start, ext_mem.end, ext_mem.size / 1024);
 	populate_pools (&base_mem, &ext_mem);
+	if (user_reserve_max == SIZE_MAX)
+		user_reserve_max = user_free_cnt / 2;
 	return ext_mem.end;
 }
 
@@ -261,22 +365,47 @@ palloc_init (void) {
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
+	return get_multiple (flags, page_cnt, MEMTRACK_SITE);
+}
+
+/* Does the work of palloc_get_multiple(), charging the pages to
+   call site SITE for memory accounting. */
+static void *
+get_multiple (enum palloc_flags flags, size_t page_cnt, const void *site) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	size_t page_idx;
 	void *pages;
 
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	if (pool == &user_pool && !quota_charge (page_cnt)) {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get: over user page quota");
+		return NULL;
+	}
+
+	/* Try for a page the idle thread already zeroed. */
+	pages = NULL;
+	if (page_cnt == 1 && (flags & PAL_ZERO))
+		pages = zero_pool_pop (pool);
+
+	if (pages == NULL) {
+		page_idx = take_pages (pool, page_cnt);
+		while (page_idx == BITMAP_ERROR && zero_pool_drain (pool))
+			page_idx = take_pages (pool, page_cnt);
+
+		if (page_idx != BITMAP_ERROR) {
+			pages = pool->base + PGSIZE * page_idx;
+			if (flags & PAL_ZERO)
+				for (size_t i = 0; i < page_cnt; i++)
+					page_zero ((uint8_t *) pages + PGSIZE * i);
+		}
+	}
 
 	if (pages) {
-		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
+		memtrack_alloc (MEMTRACK_PALLOC, site, pages, PGSIZE * page_cnt);
 	} else {
+		if (pool == &user_pool)
+			quota_credit (page_cnt, true);
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
 	}
@@ -293,7 +422,55 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_page (enum palloc_flags flags) {
-	return palloc_get_multiple (flags, 1);
+	return get_multiple (flags, 1, MEMTRACK_SITE);
+}
+
+/* Tries to grow the group of PAGE_CNT pages starting at PAGES,
+   allocated by palloc_get_multiple(), to NEW_CNT pages by taking
+   the free pages that follow it.  The new pages are not zeroed.
+   Returns true if successful, false if any of those pages is in
+   use or past the end of the pool. */
+bool
+palloc_extend (void *pages, size_t page_cnt, size_t new_cnt) {
+	struct pool *pool;
+	size_t page_idx, extra;
+	bool success;
+
+	ASSERT (pg_ofs (pages) == 0);
+	ASSERT (new_cnt >= page_cnt);
+
+	if (page_from_pool (&kernel_pool, pages))
+		pool = &kernel_pool;
+	else if (page_from_pool (&user_pool, pages))
+		pool = &user_pool;
+	else
+		NOT_REACHED ();
+
+	page_idx = pg_no (pages) - pg_no (pool->base) + page_cnt;
+	extra = new_cnt - page_cnt;
+	if (page_idx + extra > bitmap_size (pool->used_map))
+		return false;
+	if (pool == &user_pool && !quota_charge (extra))
+		return false;
+
+	if (palloc_buddy) {
+		spin_lock (&pool->buddy_lock);
+		success = bitmap_none (pool->used_map, page_idx, extra);
+		if (success) {
+			bitmap_set_multiple (pool->used_map, page_idx, extra, true);
+			buddy_claim (&pool->buddy, page_idx, extra);
+		}
+		spin_unlock (&pool->buddy_lock);
+	} else {
+		lock_acquire (&pool->lock);
+		success = bitmap_none (pool->used_map, page_idx, extra);
+		if (success)
+			bitmap_set_multiple (pool->used_map, page_idx, extra, true);
+		lock_release (&pool->lock);
+	}
+	if (!success && pool == &user_pool)
+		quota_credit (extra, true);
+	return success;
 }
 
 /* Frees the PAGE_CNT pages starting at PAGES. */
@@ -314,12 +491,20 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 		NOT_REACHED ();
 
 	page_idx = pg_no (pages) - pg_no (pool->base);
+	if (pool == &user_pool && page_cnt == 1 && drop_share (page_idx))
+		return;
+	memtrack_free (pages);
+	if (pool == &user_pool)
+		quota_credit (page_cnt, true);
 
+	/* Poison even pages parked for the idle thread to zero, which
+	   may sit on the dirty stack for a long time. */
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
-	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	if (page_cnt == 1 && zero_pool_park (pool, pages))
+		return;
+	release_pages (pool, page_idx, page_cnt);
 }
 
 /* Frees the page at PAGE. */
@@ -328,6 +513,384 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Fills the page at PAGE with zeros. */
+void
+page_zero (void *page) {
+	size_t cnt = PGSIZE / sizeof (uint64_t);
+
+	ASSERT (pg_ofs (page) == 0);
+	asm volatile ("rep stosq"
+			: "+D" (page), "+c" (cnt) : "a" (0) : "memory");
+}
+
+/* Copies the page at SRC to the page at DST. */
+void
+page_copy (void *dst, const void *src) {
+	size_t cnt = PGSIZE / sizeof (uint64_t);
+
+	ASSERT (pg_ofs (dst) == 0 && pg_ofs (src) == 0);
+	asm volatile ("rep movsq"
+			: "+D" (dst), "+S" (src), "+c" (cnt) : : "memory");
+}
+
+/* Fills the page at PAGE with zeros using non-temporal stores,
+   which bypass the cache: a page zeroed ahead of time may not be
+   used for a while, and should not evict anything that will. */
+static void
+page_zero_nocache (void *page) {
+	uint64_t *p = page;
+	size_t i;
+
+	for (i = 0; i < PGSIZE / sizeof *p; i += 4)
+		asm volatile ("movnti %1, 0(%0); movnti %1, 8(%0);"
+				"movnti %1, 16(%0); movnti %1, 24(%0)"
+				: : "r" (p + i), "r" (0ULL) : "memory");
+	asm volatile ("sfence" : : : "memory");
+}
+
+/* Zeroes one page that palloc_free_page() parked for a pool.
+   Called by the idle thread with interrupts on.  Takes no
+   sleeping lock, only the pools' zero_lock spinlocks, which
+   disable interrupts while they are held.  Returns true if it
+   zeroed a page, false if there was nothing to do. */
+bool
+palloc_zero_idle (void) {
+	struct pool *pools[] = { &user_pool, &kernel_pool };
+	size_t i;
+
+	for (i = 0; i < sizeof pools / sizeof *pools; i++) {
+		struct pool *pool = pools[i];
+		void *page = NULL;
+
+		spin_lock (&pool->zero_lock);
+		if (pool->dirty_cnt > 0)
+			page = pool->dirty[--pool->dirty_cnt];
+		spin_unlock (&pool->zero_lock);
+		if (page == NULL)
+			continue;
+
+		page_zero_nocache (page);
+
+		spin_lock (&pool->zero_lock);
+		if (pool->zero_cnt + pool->dirty_cnt < ZERO_POOL_SIZE) {
+			pool->zeroed[pool->zero_cnt++] = page;
+			page = NULL;
+		}
+		spin_unlock (&pool->zero_lock);
+		if (page != NULL)
+			release_pages (pool, pg_no (page) - pg_no (pool->base), 1);
+		return true;
+	}
+	return false;
+}
+
+/* Pops a pre-zeroed page from POOL, or returns a null pointer if
+   there is none. */
+static void *
+zero_pool_pop (struct pool *pool) {
+	void *page = NULL;
+
+	spin_lock (&pool->zero_lock);
+	if (pool->zero_cnt > 0)
+		page = pool->zeroed[--pool->zero_cnt];
+	spin_unlock (&pool->zero_lock);
+	return page;
+}
+
+/* Parks PAGE, a page of POOL being freed, for the idle thread to
+   zero.  Returns false, parking nothing, if POOL already has
+   enough pages zeroed or waiting. */
+static bool
+zero_pool_park (struct pool *pool, void *page) {
+	bool parked = false;
+
+	spin_lock (&pool->zero_lock);
+	if (pool->zero_cnt + pool->dirty_cnt < ZERO_POOL_SIZE) {
+		pool->dirty[pool->dirty_cnt++] = page;
+		parked = true;
+	}
+	spin_unlock (&pool->zero_lock);
+	return parked;
+}
+
+/* Gives all of POOL's pre-zeroed and parked pages back to it.
+   Returns true if there were any. */
+static bool
+zero_pool_drain (struct pool *pool) {
+	bool drained = false;
+
+	for (;;) {
+		void *page = NULL;
+
+		spin_lock (&pool->zero_lock);
+		if (pool->zero_cnt > 0)
+			page = pool->zeroed[--pool->zero_cnt];
+		else if (pool->dirty_cnt > 0)
+			page = pool->dirty[--pool->dirty_cnt];
+		spin_unlock (&pool->zero_lock);
+		if (page == NULL)
+			break;
+		release_pages (pool, pg_no (page) - pg_no (pool->base), 1);
+		drained = true;
+	}
+	return drained;
+}
+
+/* Marks PAGE_CNT contiguous free pages in POOL used and returns
+   the index of the first, or BITMAP_ERROR if there are none. */
+static size_t
+take_pages (struct pool *pool, size_t page_cnt) {
+	size_t page_idx;
+
+	if (palloc_buddy) {
+		spin_lock (&pool->buddy_lock);
+		page_idx = buddy_alloc (&pool->buddy, page_cnt);
+		if (page_idx != BUDDY_ERROR) {
+			ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+			bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+		} else
+			page_idx = BITMAP_ERROR;
+		spin_unlock (&pool->buddy_lock);
+	} else {
+		lock_acquire (&pool->lock);
+		page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+		lock_release (&pool->lock);
+	}
+	return page_idx;
+}
+
+/* Marks the PAGE_CNT pages starting at PAGE_IDX in POOL free. */
+static void
+release_pages (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	if (palloc_buddy) {
+		spin_lock (&pool->buddy_lock);
+		ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+		bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+		buddy_free (&pool->buddy, page_idx, page_cnt);
+		spin_unlock (&pool->buddy_lock);
+		return;
+	}
+	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+}
+
+/* Returns the part of Q's reservation that Q does not hold. */
+static size_t
+unused_reserve (const struct user_quota *q) {
+	return q->reserve > q->used ? q->reserve - q->used : 0;
+}
+
+/* Updates reserved_unused for a quota whose unused reservation
+   changed from OLD_UNUSED to NEW_UNUSED.  Growth that free pages
+   do not back is not counted, so that reserved_unused never
+   exceeds user_free_cnt, and a shrink stops at zero, since part
+   of OLD_UNUSED may never have been counted.  Quota_lock must be
+   held, and if the reservation grew, user_free_cnt must already
+   be up to date. */
+static void
+reserve_adjust (size_t old_unused, size_t new_unused) {
+	if (new_unused >= old_unused) {
+		size_t grow = new_unused - old_unused;
+		size_t room = user_free_cnt - reserved_unused;
+		reserved_unused += grow < room ? grow : room;
+	} else {
+		size_t shrink = old_unused - new_unused;
+		reserved_unused -= shrink < reserved_unused ? shrink : reserved_unused;
+	}
+	ASSERT (reserved_unused <= user_free_cnt);
+}
+
+/* Charges PAGE_CNT user pool pages to the running thread.
+   Returns false, charging nothing, if that would put it over its
+   limit or would leave too few free pages for other threads'
+   reservations. */
+static bool
+quota_charge (size_t page_cnt) {
+	struct user_quota *q = &thread_current ()->uquota;
+	size_t own, unreserved;
+	bool success;
+
+	spin_lock (&quota_lock);
+	own = unused_reserve (q);
+	if (own > page_cnt)
+		own = page_cnt;
+	unreserved = user_free_cnt - reserved_unused;
+	success = q->used + page_cnt <= q->limit
+		&& page_cnt <= user_free_cnt
+		&& page_cnt - own <= unreserved;
+	if (success) {
+		size_t old_unused = unused_reserve (q);
+		q->used += page_cnt;
+		reserve_adjust (old_unused, unused_reserve (q));
+		user_free_cnt -= page_cnt;
+	}
+	spin_unlock (&quota_lock);
+	return success;
+}
+
+/* Credits PAGE_CNT user pool pages back to the running thread.
+   FREED is true if the pages are going back to the pool, false
+   if other holders still map them. */
+static void
+quota_credit (size_t page_cnt, bool freed) {
+	struct user_quota *q = &thread_current ()->uquota;
+	size_t old_unused;
+
+	spin_lock (&quota_lock);
+	old_unused = unused_reserve (q);
+	q->used -= page_cnt < q->used ? page_cnt : q->used;
+	if (freed)
+		user_free_cnt += page_cnt;
+	reserve_adjust (old_unused, unused_reserve (q));
+	spin_unlock (&quota_lock);
+}
+
+/* Makes the running thread another holder of user pool page
+   PAGE, which some other process already maps, and charges the
+   page to it.  The page then goes back to the pool only after
+   every holder has passed it to palloc_free_page().  Returns
+   false, changing nothing, if that would put the running thread
+   over its limit. */
+bool
+palloc_share_page (void *page) {
+	struct user_quota *q = &thread_current ()->uquota;
+	size_t page_idx, old_unused;
+	bool success;
+
+	ASSERT (pg_ofs (page) == 0);
+	ASSERT (page_from_pool (&user_pool, page));
+	page_idx = pg_no (page) - pg_no (user_pool.base);
+
+	spin_lock (&quota_lock);
+	success = q->used < q->limit && user_pool.shares[page_idx] < UINT16_MAX;
+	if (success) {
+		old_unused = unused_reserve (q);
+		q->used++;
+		reserve_adjust (old_unused, unused_reserve (q));
+		user_pool.shares[page_idx]++;
+	}
+	spin_unlock (&quota_lock);
+	return success;
+}
+
+/* Moves the charge for one user pool page from quota FROM to the
+   running thread, which is taking the page over from FROM's
+   process, as when it evicts one of that process's pages. */
+void
+palloc_take_charge (struct user_quota *from) {
+	struct user_quota *to = &thread_current ()->uquota;
+	size_t old_unused;
+
+	if (from == to)
+		return;
+
+	/* Shrink TO's reservation first, which can only make room for
+	   FROM's to grow. */
+	spin_lock (&quota_lock);
+	old_unused = unused_reserve (to);
+	to->used++;
+	reserve_adjust (old_unused, unused_reserve (to));
+	old_unused = unused_reserve (from);
+	if (from->used > 0)
+		from->used--;
+	reserve_adjust (old_unused, unused_reserve (from));
+	spin_unlock (&quota_lock);
+}
+
+/* Removes the process with quota FROM from the holders of user
+   pool page PAGE, which must have others, and credits FROM for
+   it, as when an evicting process takes a shared page away from
+   every holder but one. */
+void
+palloc_drop_share (void *page, struct user_quota *from) {
+	size_t page_idx, old_unused;
+
+	ASSERT (page_from_pool (&user_pool, page));
+	page_idx = pg_no (page) - pg_no (user_pool.base);
+
+	spin_lock (&quota_lock);
+	ASSERT (user_pool.shares[page_idx] > 0);
+	user_pool.shares[page_idx]--;
+	old_unused = unused_reserve (from);
+	if (from->used > 0)
+		from->used--;
+	reserve_adjust (old_unused, unused_reserve (from));
+	spin_unlock (&quota_lock);
+}
+
+/* Returns the number of holders of user pool page PAGE. */
+size_t
+palloc_page_holders (void *page) {
+	ASSERT (page_from_pool (&user_pool, page));
+	return user_pool.shares[pg_no (page) - pg_no (user_pool.base)] + 1;
+}
+
+/* If the user pool page at PAGE_IDX has other holders, removes
+   the running thread from them, credits it for the page, and
+   returns true.  Otherwise, returns false. */
+static bool
+drop_share (size_t page_idx) {
+	bool shared;
+
+	spin_lock (&quota_lock);
+	shared = user_pool.shares[page_idx] > 0;
+	if (shared)
+		user_pool.shares[page_idx]--;
+	spin_unlock (&quota_lock);
+
+	if (shared)
+		quota_credit (1, false);
+	return shared;
+}
+
+/* Sets the running thread's user pool quota to at most LIMIT
+   pages, RESERVE of them set aside for it.  Returns false,
+   changing nothing, if LIMIT is above the current limit, RESERVE
+   exceeds LIMIT, the reservations of all processes would exceed
+   user_reserve_max, or there are not enough unreserved free pages
+   to set aside. */
+bool
+palloc_set_quota (size_t limit, size_t reserve) {
+	struct user_quota *q = &thread_current ()->uquota;
+	size_t old_unused, new_unused;
+	bool success;
+
+	if (reserve > limit)
+		return false;
+
+	spin_lock (&quota_lock);
+	old_unused = unused_reserve (q);
+	new_unused = reserve > q->used ? reserve - q->used : 0;
+	success = limit <= q->limit
+		&& reserved_total - q->reserve + reserve <= user_reserve_max
+		&& (new_unused <= old_unused
+			|| new_unused - old_unused <= user_free_cnt - reserved_unused);
+	if (success) {
+		reserve_adjust (old_unused, new_unused);
+		reserved_total = reserved_total - q->reserve + reserve;
+		q->limit = limit;
+		q->reserve = reserve;
+	}
+	spin_unlock (&quota_lock);
+	return success;
+}
+
+/* Returns true if the process with quota Q holds no more user
+   pool pages than it has reserved, so that others should not
+   take its pages from it. */
+bool
+palloc_within_reserve (const struct user_quota *q) {
+	return q->used <= q->reserve;
+}
+
+/* Returns true if the running thread holds as many user pool
+   pages as its quota allows. */
+bool
+palloc_over_quota (void) {
+	struct user_quota *q = &thread_current ()->uquota;
+	return q->used >= q->limit;
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -345,6 +908,27 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
 	bitmap_set_all(p->used_map, true);
 
 	*bm_base += bm_pages;
+
+	spin_lock_init (&p->zero_lock);
+	p->zero_cnt = 0;
+	p->dirty_cnt = 0;
+
+	// User pool share counts follow.
+	p->shares = NULL;
+	if (p == &user_pool) {
+		size_t share_pages = DIV_ROUND_UP (pgcnt * sizeof *p->shares, PGSIZE) * PGSIZE;
+		p->shares = *bm_base;
+		memset (p->shares, 0, share_pages);
+		*bm_base += share_pages;
+	}
+
+	// Put the buddy bookkeeping right after the bitmap.
+	spin_lock_init (&p->buddy_lock);
+	if (palloc_buddy) {
+		size_t meta_pages = DIV_ROUND_UP (buddy_meta_size (pgcnt), PGSIZE) * PGSIZE;
+		buddy_init (&p->buddy, pgcnt, *bm_base);
+		*bm_base += meta_pages;
+	}
 }
 
 /* Returns true if PAGE was allocated from POOL,
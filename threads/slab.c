@@ -0,0 +1,300 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/memtrack.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Object caches ("slabs") for fixed-size kernel objects.
+
+   malloc() rounds every request up to a power of 2, so a 544-byte
+   inode takes a 1024-byte block and only 3 fit in a page.  A
+   kmem_cache instead serves objects of exactly one size, rounded
+   up only to SLAB_ALIGN, from pages called slabs.  Each slab
+   starts with a small header and is then carved into as many
+   objects as fit, so the same page holds 7 inodes.
+
+   A cache keeps the slabs that still have free objects on its
+   partial list; slabs with no free objects are kept on no list
+   at all, and kmem_cache_free() finds an object's slab by
+   rounding its address down to a page boundary.  Free objects
+   within a slab are linked through their first bytes.  When a
+   slab becomes entirely free it is returned to the page
+   allocator, except that each cache keeps one empty slab around
+   so that a workload hovering at a slab boundary does not call
+   palloc on every other operation.
+
+   If a cache has a constructor, it is run on each object as it
+   is handed out by kmem_cache_alloc(). */
+
+/* Object alignment in bytes.  Also the minimum object size,
+   since free objects hold a link. */
+#define SLAB_ALIGN sizeof (void *)
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Object cache. */
+struct kmem_cache {
+	const char *name;           /* Name, for statistics. */
+	size_t obj_size;            /* Requested object size. */
+	size_t slot_size;           /* Object size rounded to SLAB_ALIGN. */
+	size_t objs_per_slab;       /* Number of objects in a slab. */
+	void (*ctor) (void *);      /* Constructor, or a null pointer. */
+	struct mutex lock;          /* Protects the members below. */
+	struct list partial;        /* Slabs with at least one free object. */
+	size_t empty_cnt;           /* Entirely free slabs on PARTIAL. */
+	size_t slab_cnt;            /* Slabs owned by this cache. */
+	size_t in_use;              /* Objects allocated and not freed. */
+	long long allocs;           /* Total calls to kmem_cache_alloc(). */
+	long long frees;            /* Total calls to kmem_cache_free(). */
+	struct list_elem elem;      /* Element in all_caches. */
+};
+
+/* Slab header, at the start of each slab page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in cache's partial list. */
+	void *free;                 /* First free object. */
+	size_t free_cnt;            /* Number of free objects. */
+};
+
+/* Offset of the first object in a slab. */
+#define SLAB_HDR ROUND_UP (sizeof (struct slab), SLAB_ALIGN)
+
+/* All caches, for kmem_cache_print_stats(). */
+static struct list all_caches;
+static struct mutex all_caches_lock;
+
+static void *cache_get (struct kmem_cache *);
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+
+/* Initializes the list of caches.  Must be called after
+   malloc_init() and before kmem_cache_create(). */
+void
+kmem_cache_init (void) {
+	list_init (&all_caches);
+	mutex_init (&all_caches_lock);
+}
+
+/* Creates and returns a cache of SIZE-byte objects named NAME,
+   which must remain valid for the lifetime of the cache.  If CTOR
+   is nonnull, it is called on each object returned by
+   kmem_cache_alloc().  Returns a null pointer if memory is not
+   available. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, void (*ctor) (void *)) {
+	struct kmem_cache *c;
+
+	ASSERT (name != NULL);
+	ASSERT (size > 0 && size <= PGSIZE - SLAB_HDR);
+
+	c = malloc (sizeof *c);
+	if (c == NULL)
+		return NULL;
+	c->name = name;
+	c->obj_size = size;
+	c->slot_size = ROUND_UP (size, SLAB_ALIGN);
+	c->objs_per_slab = (PGSIZE - SLAB_HDR) / c->slot_size;
+	c->ctor = ctor;
+	mutex_init (&c->lock);
+	list_init (&c->partial);
+	c->empty_cnt = 0;
+	c->slab_cnt = 0;
+	c->in_use = 0;
+	c->allocs = 0;
+	c->frees = 0;
+
+	mutex_acquire (&all_caches_lock);
+	list_push_back (&all_caches, &c->elem);
+	mutex_release (&all_caches_lock);
+	return c;
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	void *obj = cache_get (c);
+	if (obj != NULL) {
+		memtrack_alloc (MEMTRACK_SLAB, MEMTRACK_SITE, obj, c->obj_size);
+		if (c->ctor != NULL)
+			c->ctor (obj);
+	}
+	return obj;
+}
+
+/* Like kmem_cache_alloc(), but zeroes the object before running
+   C's constructor. */
+void *
+kmem_cache_zalloc (struct kmem_cache *c) {
+	void *obj = cache_get (c);
+	if (obj != NULL) {
+		memtrack_alloc (MEMTRACK_SLAB, MEMTRACK_SITE, obj, c->obj_size);
+		memset (obj, 0, c->obj_size);
+		if (c->ctor != NULL)
+			c->ctor (obj);
+	}
+	return obj;
+}
+
+/* Takes an unconstructed object from cache C, creating a new
+   slab if C has none free.  Returns a null pointer if memory is
+   not available. */
+static void *
+cache_get (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	mutex_acquire (&c->lock);
+	if (list_empty (&c->partial)) {
+		s = slab_create (c);
+		if (s == NULL) {
+			mutex_release (&c->lock);
+			return NULL;
+		}
+		list_push_front (&c->partial, &s->elem);
+	} else
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+
+	/* Take the first free object. */
+	if (s->free_cnt == c->objs_per_slab)
+		c->empty_cnt--;
+	obj = s->free;
+	s->free = *(void **) obj;
+	if (--s->free_cnt == 0)
+		list_remove (&s->elem);
+	c->in_use++;
+	c->allocs++;
+	mutex_release (&c->lock);
+	return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C.  Does nothing if OBJ is a null pointer. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+
+	if (obj == NULL)
+		return;
+	s = obj_to_slab (c, obj);
+	memtrack_free (obj);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs. */
+	memset (obj, 0xcc, c->obj_size);
+#endif
+
+	mutex_acquire (&c->lock);
+	*(void **) obj = s->free;
+	s->free = obj;
+	if (s->free_cnt++ == 0)
+		list_push_front (&c->partial, &s->elem);
+	c->in_use--;
+	c->frees++;
+
+	/* Keep one empty slab; give any other back. */
+	if (s->free_cnt == c->objs_per_slab) {
+		if (c->empty_cnt == 0)
+			c->empty_cnt++;
+		else {
+			list_remove (&s->elem);
+			c->slab_cnt--;
+			s->magic = 0;
+			palloc_free_page (s);
+		}
+	}
+	mutex_release (&c->lock);
+}
+
+/* Returns the number of pages currently owned by cache C. */
+size_t
+kmem_cache_pages (struct kmem_cache *c) {
+	return c->slab_cnt;
+}
+
+/* Returns the number of pages malloc() would need to hold C's
+   objects that are currently in use. */
+static size_t
+malloc_pages (struct kmem_cache *c) {
+	size_t block_size = 16;
+	size_t per_page;
+
+	while (block_size < c->obj_size)
+		block_size *= 2;
+	if (block_size >= PGSIZE / 2)
+		return c->in_use * DIV_ROUND_UP (c->obj_size + SLAB_HDR, PGSIZE);
+	per_page = (PGSIZE - SLAB_HDR) / block_size;
+	return DIV_ROUND_UP (c->in_use, per_page);
+}
+
+/* Prints statistics for every cache. */
+void
+kmem_cache_print_stats (void) {
+	struct list_elem *e;
+
+	mutex_acquire (&all_caches_lock);
+	for (e = list_begin (&all_caches); e != list_end (&all_caches);
+			e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+		printf ("Slab %s: %zu-byte objects, %zu in use in %zu pages "
+				"(malloc: %zu), %lld allocs, %lld frees\n",
+				c->name, c->obj_size, c->in_use, c->slab_cnt,
+				malloc_pages (c), c->allocs, c->frees);
+	}
+	mutex_release (&all_caches_lock);
+}
+
+/* Allocates a new slab for cache C, which must be locked, and
+   links all of its objects into its free list.  The slab is
+   counted as empty.  Returns a null pointer if memory is not
+   available. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s;
+	uint8_t *obj;
+	size_t i;
+
+	ASSERT (mutex_held_by_current_thread (&c->lock));
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->free = NULL;
+	s->free_cnt = c->objs_per_slab;
+	obj = (uint8_t *) s + SLAB_HDR + (c->objs_per_slab - 1) * c->slot_size;
+	for (i = 0; i < c->objs_per_slab; i++, obj -= c->slot_size) {
+		*(void **) obj = s->free;
+		s->free = obj;
+	}
+	c->slab_cnt++;
+	c->empty_cnt++;
+	return s;
+}
+
+/* Returns the slab that OBJ, an object of cache C, is in. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	/* Check that the slab is valid and belongs to C. */
+	ASSERT (s != NULL);
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+
+	/* Check that the object is properly aligned for the slab. */
+	ASSERT ((pg_ofs (obj) - SLAB_HDR) % c->slot_size == 0);
+
+	return s;
+}
@@ -30,7 +30,9 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -178,6 +180,7 @@ lock_init (struct lock *lock) {
 
 	lock->holder = NULL;
 	sema_init (&lock->semaphore, 1);
+	heap_init (&lock->donors, donor_priority_less, NULL);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -194,20 +197,32 @@ lock_acquire (struct lock *lock) {
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
 	struct thread *curr = thread_current ();
+	enum intr_level old_level = intr_disable ();
+	bool donating = false;
+	uint64_t wait_start = lock->holder ? rdtsc () : 0;
 	if(!thread_mlfqs){
-		// priority 순으로 donation 리스트 넣는법....
 		if(lock->holder){
 			curr->wait_on_lock = lock; // lock을 필요로 하는 thread의 address 저장
-			list_insert_ordered(&curr->wait_on_lock->holder->donation, &curr->d_elem, donation_priority_less,NULL); // donation 리스트에 넣기.
+			heap_push(&lock->donors, &curr->donor_elem); // lock의 donor heap에 넣기.
+			donating = true;
 
 			donate_priority();
 		}
 	}
 	sema_down (&lock->semaphore);
+	if (wait_start != 0)
+		thread_account_lock_wait (rdtsc () - wait_start);
 
-	lock->holder = thread_current ();
+	lock->holder = curr;
 	curr->wait_on_lock = NULL;
-
+	if(!thread_mlfqs){
+		if(donating)
+			heap_remove(&lock->donors, &curr->donor_elem);
+		// 남은 waiter들의 기부를 이어받음.
+		heap_push(&curr->held_locks, &lock->elem);
+		donate_set_priority(curr);
+	}
+	intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -224,8 +239,14 @@ lock_try_acquire (struct lock *lock) {
 	ASSERT (!lock_held_by_current_thread (lock));
 
 	success = sema_try_down (&lock->semaphore);
-	if (success)
+	if (success) {
 		lock->holder = thread_current ();
+		if (!thread_mlfqs) {
+			enum intr_level old_level = intr_disable ();
+			heap_push (&lock->holder->held_locks, &lock->elem);
+			intr_set_level (old_level);
+		}
+	}
 	return success;
 
 }
@@ -241,36 +262,16 @@ lock_release (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if(!thread_mlfqs){
-		struct list_elem *e;
-		struct thread *holde = lock->holder;
-		// donation list를 순회하며 해당하는 lock을 가진 thread list에서 제거
-		if (!list_empty(&holde->donation)){	
-			for(e = list_begin(&holde->donation); e != list_end(&holde->donation);)
-			{
-					if(list_entry(e, struct thread, d_elem)->wait_on_lock == lock){
-						list_entry(e, struct thread, d_elem)->wait_on_lock = NULL; // wait_on_lock 초기화
-						// 해당하는 스레드의 priority 초기화
-						donate_set_priority(list_entry(e, struct thread, d_elem));
-						list_remove(e); // d_elem 제거
-						}
-					else{
-						e = list_next(e);
-						}
-				}
-			}
-
-		// Donation 용 추가 (여기까지)
-	}
+	enum intr_level old_level = intr_disable ();
 	lock->holder = NULL;
-	
-	// 현재 스레드의 priority를 init 값으로 초기화
+
+	// 이 lock으로 받던 기부를 빼고 priority 재계산.
 	if(!thread_mlfqs){
+		heap_remove(&thread_current()->held_locks, &lock->elem);
 		donate_set_priority(thread_current());
 	}
 	sema_up (&lock->semaphore);
-
-	
+	intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -282,7 +283,392 @@ lock_held_by_current_thread (const struct lock *lock) {
 
 	return lock->holder == thread_current ();
 }
+
+/* Returns the highest priority among the threads waiting on
+   LOCK, or PRI_MIN - 1 if there are none. */
+int
+lock_donated_priority (struct lock *lock) {
+	ASSERT (lock != NULL);
+
+	if (heap_empty (&lock->donors))
+		return PRI_MIN - 1;
+	return heap_entry (heap_top (&lock->donors), struct thread,
+			donor_elem)->priority;
+}
+
+/* Orders the locks in a thread's held_locks heap by the priority
+   they donate. */
+bool
+lock_priority_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	struct lock *lock_a = heap_entry (a, struct lock, elem);
+	struct lock *lock_b = heap_entry (b, struct lock, elem);
+
+	return lock_donated_priority (lock_a) < lock_donated_priority (lock_b);
+}
 
+/* Number of times a contended mutex_acquire() re-checks the
+   mutex before giving up and blocking. */
+#define MUTEX_SPIN_LIMIT 64
+
+/* Initializes MUTEX.  A mutex can be held by at most a single
+   thread at any given time, like a lock, but is cheaper to take
+   when the critical section is short.  See synch.h. */
+void
+mutex_init (struct mutex *mutex) {
+	ASSERT (mutex != NULL);
+
+	mutex->state = 0;
+	mutex->holder = NULL;
+	list_init (&mutex->waiters);
+}
+
+/* Acquires MUTEX, first spinning or yielding while the holder
+   can make progress and sleeping only if that does not free it.
+   The mutex must not already be held by the current thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+mutex_acquire (struct mutex *mutex) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	uint64_t wait_start;
+	int spin;
+
+	ASSERT (mutex != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!mutex_held_by_current_thread (mutex));
+
+	/* Fast path. */
+	if (__sync_bool_compare_and_swap (&mutex->state, 0, 1)) {
+		mutex->holder = curr;
+		return;
+	}
+
+	wait_start = rdtsc ();
+	for (spin = 0; spin < MUTEX_SPIN_LIMIT; spin++) {
+		struct thread *holder = mutex->holder;
+
+		if (mutex->state == 0
+				&& __sync_bool_compare_and_swap (&mutex->state, 0, 1))
+			goto acquired;
+		if (holder == NULL || holder->status == THREAD_RUNNING)
+			__asm __volatile ("pause");
+		else if (holder->status == THREAD_READY
+				&& holder->priority >= curr->priority)
+			thread_yield ();
+		else
+			break;
+	}
+
+	/* Slow path: sleep until mutex_release() hands us the mutex. */
+	old_level = intr_disable ();
+	if (__sync_bool_compare_and_swap (&mutex->state, 0, 1)) {
+		intr_set_level (old_level);
+		goto acquired;
+	}
+	mutex->state = 2;
+	list_insert_ordered (&mutex->waiters, &curr->elem,
+			thread_donation_priority_less, NULL);
+	thread_block ();
+	ASSERT (mutex->holder == curr);
+	intr_set_level (old_level);
+	thread_account_lock_wait (rdtsc () - wait_start);
+	return;
+
+acquired:
+	mutex->holder = curr;
+	thread_account_lock_wait (rdtsc () - wait_start);
+}
+
+/* Tries to acquire MUTEX and returns true if successful or false
+   on failure.  The mutex must not already be held by the current
+   thread.
+
+   This function will not sleep, so it may be called within an
+   interrupt handler. */
+bool
+mutex_try_acquire (struct mutex *mutex) {
+	ASSERT (mutex != NULL);
+	ASSERT (!mutex_held_by_current_thread (mutex));
+
+	if (!__sync_bool_compare_and_swap (&mutex->state, 0, 1))
+		return false;
+	mutex->holder = thread_current ();
+	return true;
+}
+
+/* Releases MUTEX, which must be owned by the current thread.  If
+   threads are blocked on it, ownership passes directly to the
+   highest-priority one. */
+void
+mutex_release (struct mutex *mutex) {
+	enum intr_level old_level;
+	struct thread *next;
+
+	ASSERT (mutex != NULL);
+	ASSERT (mutex_held_by_current_thread (mutex));
+
+	mutex->holder = NULL;
+	if (__sync_bool_compare_and_swap (&mutex->state, 1, 0))
+		return;
+
+	old_level = intr_disable ();
+	ASSERT (mutex->state == 2 && !list_empty (&mutex->waiters));
+	next = list_entry (list_pop_front (&mutex->waiters), struct thread, elem);
+	mutex->holder = next;
+	if (list_empty (&mutex->waiters))
+		mutex->state = 1;
+	thread_unblock (next);
+	if (!intr_context () && next->priority > thread_current ()->priority)
+		thread_yield ();
+	intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds MUTEX, false
+   otherwise. */
+bool
+mutex_held_by_current_thread (const struct mutex *mutex) {
+	ASSERT (mutex != NULL);
+
+	return mutex->holder == thread_current ();
+}
+
+/* Initializes RW.  See synch.h for the rules it follows. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	rw->readers = 0;
+	list_init (&rw->holders);
+	list_init (&rw->read_waiters);
+	list_init (&rw->write_waiters);
+	heap_init (&rw->donors, donor_priority_less, NULL);
+}
+
+/* Returns the current thread's hold on RW, or a null pointer if it
+   does not hold RW. */
+static struct rw_hold *
+rw_hold_find (const struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	struct list_elem *e;
+
+	for (e = list_begin (&curr->rw_holds); e != list_end (&curr->rw_holds);
+			e = list_next (e)) {
+		struct rw_hold *hold = list_entry (e, struct rw_hold, thread_elem);
+		if (hold->rw == rw)
+			return hold;
+	}
+	return NULL;
+}
+
+/* Allocates a hold for rwlock_acquire_read() or
+   rwlock_acquire_write() to record with rw_hold_add().  Called
+   before disabling interrupts, since malloc() may sleep. */
+static struct rw_hold *
+rw_hold_alloc (void) {
+	struct rw_hold *hold = malloc (sizeof *hold);
+
+	if (hold == NULL)
+		PANIC ("out of memory for rwlock hold");
+	return hold;
+}
+
+/* Records HOLD as the current thread's hold on RW, taking over
+   the priority donated by the threads waiting on it.  Interrupts
+   must be off. */
+static void
+rw_hold_add (struct rwlock *rw, struct rw_hold *hold) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	hold->rw = rw;
+	hold->thread = curr;
+	list_push_back (&rw->holders, &hold->elem);
+	list_push_back (&curr->rw_holds, &hold->thread_elem);
+	if (!thread_mlfqs)
+		donate_set_priority (curr);
+}
+
+/* Drops the current thread's hold on RW and the priority donated
+   through it, and returns the hold for the caller to free once
+   interrupts are back on.  Interrupts must be off. */
+static struct rw_hold *
+rw_hold_remove (struct rwlock *rw) {
+	struct rw_hold *hold = rw_hold_find (rw);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (hold != NULL);
+	list_remove (&hold->elem);
+	list_remove (&hold->thread_elem);
+	if (!thread_mlfqs)
+		donate_set_priority (thread_current ());
+	return hold;
+}
+
+/* Blocks the current thread on WAITERS, one of RW's wait lists,
+   donating its priority to RW's holders while it waits.  Returns
+   once a releaser has handed RW over.  Interrupts must be off. */
+static void
+rw_wait (struct rwlock *rw, struct list *waiters) {
+	struct thread *curr = thread_current ();
+	uint64_t wait_start = rdtsc ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	list_push_back (waiters, &curr->elem);
+	if (!thread_mlfqs) {
+		curr->wait_on_rw = rw;
+		heap_push (&rw->donors, &curr->donor_elem);
+		donate_priority ();
+	}
+	thread_block ();
+	if (!thread_mlfqs) {
+		heap_remove (&rw->donors, &curr->donor_elem);
+		curr->wait_on_rw = NULL;
+	}
+	thread_account_lock_wait (rdtsc () - wait_start);
+}
+
+/* Wakes up the highest-priority thread in WAITERS, which must not
+   be empty.  Returns the thread woken up. */
+static struct thread *
+rw_wake_one (struct list *waiters) {
+	struct list_elem *e = list_min (waiters, thread_donation_priority_less,
+			NULL);
+	struct thread *t = list_entry (e, struct thread, elem);
+
+	list_remove (e);
+	thread_unblock (t);
+	return t;
+}
+
+/* Acquires RW for reading, sleeping while it is write-held or a
+   writer is waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	enum intr_level old_level;
+	struct rw_hold *hold;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!rwlock_held_by_current_thread (rw));
+
+	hold = rw_hold_alloc ();
+	old_level = intr_disable ();
+	if (rw->readers >= 0 && list_empty (&rw->write_waiters))
+		rw->readers++;
+	else
+		rw_wait (rw, &rw->read_waiters);
+	rw_hold_add (rw, hold);
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   The last reader out hands RW to the highest-priority waiting
+   writer, if any. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	enum intr_level old_level;
+	struct thread *next = NULL;
+	struct rw_hold *hold;
+
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_held_by_current_thread (rw));
+	ASSERT (rw->readers > 0);
+
+	old_level = intr_disable ();
+	hold = rw_hold_remove (rw);
+	if (--rw->readers == 0 && !list_empty (&rw->write_waiters)) {
+		rw->readers = -1;
+		next = rw_wake_one (&rw->write_waiters);
+	}
+	if (next != NULL && next->priority > thread_current ()->priority)
+		thread_yield ();
+	intr_set_level (old_level);
+	free (hold);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	enum intr_level old_level;
+	struct rw_hold *hold;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!rwlock_held_by_current_thread (rw));
+
+	hold = rw_hold_alloc ();
+	old_level = intr_disable ();
+	if (rw->readers == 0)
+		rw->readers = -1;
+	else
+		rw_wait (rw, &rw->write_waiters);
+	rw_hold_add (rw, hold);
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing.
+   RW passes to the highest-priority waiting writer if there is
+   one, and otherwise to every waiting reader. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	enum intr_level old_level;
+	int max_priority = PRI_MIN - 1;
+	struct rw_hold *hold;
+
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_held_by_current_thread (rw));
+	ASSERT (rw->readers == -1);
+
+	old_level = intr_disable ();
+	hold = rw_hold_remove (rw);
+	if (!list_empty (&rw->write_waiters))
+		max_priority = rw_wake_one (&rw->write_waiters)->priority;
+	else {
+		rw->readers = 0;
+		while (!list_empty (&rw->read_waiters)) {
+			struct thread *t = rw_wake_one (&rw->read_waiters);
+			if (t->priority > max_priority)
+				max_priority = t->priority;
+			rw->readers++;
+		}
+	}
+	if (max_priority > thread_current ()->priority)
+		thread_yield ();
+	intr_set_level (old_level);
+	free (hold);
+}
+
+/* Returns true if the current thread holds RW for reading or
+   writing, false otherwise. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return rw_hold_find (rw) != NULL;
+}
+
+/* Returns the highest priority among the threads waiting on RW,
+   or PRI_MIN - 1 if there are none. */
+int
+rwlock_donated_priority (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	if (heap_empty (&rw->donors))
+		return PRI_MIN - 1;
+	return heap_entry (heap_top (&rw->donors), struct thread,
+			donor_elem)->priority;
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem {
 	struct list_elem elem;              /* List element. */
@@ -394,3 +780,41 @@ bool semaphore_priority_less(const struct list_elem *a,
     return thread_a->priority > thread_b->priority;
 }
 
+
+/* Initializes spinlock LOCK as released. */
+void
+spin_lock_init (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	lock->locked = 0;
+	lock->old_level = INTR_OFF;
+}
+
+/* Disables interrupts and busy-waits until LOCK is acquired. */
+void
+spin_lock (struct spinlock *lock) {
+	enum intr_level old_level;
+
+	ASSERT (lock != NULL);
+
+	old_level = intr_disable ();
+	while (__sync_lock_test_and_set (&lock->locked, 1))
+		while (lock->locked)
+			asm volatile ("pause");
+	lock->old_level = old_level;
+}
+
+/* Releases LOCK and restores the interrupt level it was
+   acquired with. */
+void
+spin_unlock (struct spinlock *lock) {
+	enum intr_level old_level;
+
+	ASSERT (lock != NULL);
+	ASSERT (lock->locked);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	old_level = lock->old_level;
+	__sync_lock_release (&lock->locked);
+	intr_set_level (old_level);
+}
@@ -7,6 +7,9 @@
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/init.h"
+#include "threads/mmu.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -28,24 +31,49 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   One FIFO list per priority level plus an occupancy mask: bit
+   (PRI_MAX - p) of ready_mask is set iff ready_queues[p] is not
+   empty, so the highest ready priority is the lowest set bit. */
+static struct list ready_queues[PRI_CNT];
+static uint64_t ready_mask;
+static size_t ready_cnt;        /* # of threads in ready_queues. */
 
 /* Idle thread. */
 static struct thread *idle_thread;
 
+/* Running thread, set by thread_launch(). */
+static struct thread *curr_thread;
+
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
 /* Lock used by allocate_tid(). */
-static struct lock tid_lock;
+static struct mutex tid_lock;
 
 /* Thread destruction requests */
 static struct list destruction_req;
 
-// sleep 함수용 리스트.
-static struct list sleep_list;
+/* Thread-object cache.  Dead threads' pages are kept here, each
+   still paired with its guarded kernel stack, so thread_create()
+   can reuse them without going through the page allocator or
+   touching page tables.  Only accessed with interrupts off. */
+#define THREAD_CACHE_MAX 16
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+
+/* Sleeping threads, as a binary min-heap keyed by wake-up tick
+   (`struct thread'.ticks).  The array is grown from palloc by
+   thread_sleep(), never from the timer interrupt.  next_wakeup
+   caches sleep_heap[0]->ticks, or INT64_MAX if nobody sleeps, so
+   that the common tick with nothing due costs one comparison. */
+static struct thread **sleep_heap;
+static size_t sleep_cnt;        /* # of threads in sleep_heap. */
+static size_t sleep_cap;        /* Capacity of sleep_heap, in entries. */
+static int64_t next_wakeup;
 
 // mlfqs 용
 static struct list all_list;
@@ -53,16 +81,34 @@ static struct list all_list;
 // mlfqs 용
 static int load_avg; // load_avg 전역 변수.
 
+/* Once-per-second recent_cpu decay for the MLFQS.  The timer
+   interrupt only records the decay coefficient for the new second
+   in decay_coef[] and bumps decay_epoch; decay_thread then sweeps
+   the runnable threads outside interrupt context.  A blocked
+   thread remembers the last epoch it was decayed for and catches
+   up when it wakes (see calculating_recent_cpu()), so the history
+   only needs to outlive the sweep's catch-up threshold. */
+#define DECAY_HIST 64
+static int decay_coef[DECAY_HIST];
+static unsigned decay_epoch;    /* # of decays recorded so far. */
+static unsigned sweep_epoch;    /* Last epoch swept by decay_thread. */
+static struct thread *decay_thread;
+
 
 /* Statistics. */
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+static uint64_t switch_start;   /* TSC at start of last switch. */
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
+/* System-wide scheduler latency counters.  Each thread keeps the
+   same counters for itself in `struct thread'.stats. */
+static struct sched_stats sched_stats;
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
@@ -99,22 +145,30 @@ bool thread_mlfqs;
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
+static void mlfqs_sweep (void *aux UNUSED);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static struct thread *thread_alloc (uint8_t **kstack);
+static void thread_free (struct thread *);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static struct thread *ready_queue_pop (void);
+static void account_switch_in (void);
+static void sleep_heap_grow (void);
+static void sleep_heap_push (struct thread *);
+static struct thread *sleep_heap_pop (void);
 
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
 
 /* Returns the running thread.
- * Read the CPU's stack pointer `rsp', and then round that
- * down to the start of a page.  Since `struct thread' is
- * always at the beginning of a page and the stack pointer is
- * somewhere in the middle, this locates the curent thread. */
-#define running_thread() ((struct thread *) (pg_round_down (rrsp ())))
+ * Kernel stacks no longer share a page with their `struct
+ * thread', so this is recorded by thread_launch(). */
+#define running_thread() (curr_thread)
 
 
 // Global descriptor table for the thread_start.
@@ -149,11 +203,18 @@ thread_init (void) {
 	lgdt (&gdt_ds);
 
 	/* Init the globla thread context */
-	lock_init (&tid_lock);
-	list_init (&ready_list);
+	mutex_init (&tid_lock);
+	for (int i = 0; i < PRI_CNT; i++)
+		list_init (&ready_queues[i]);
+	ready_mask = 0;
+	ready_cnt = 0;
 	list_init (&destruction_req);
-	// sleep list 용
-	list_init (&sleep_list);
+	list_init (&thread_cache);
+	thread_cache_cnt = 0;
+	// sleep heap 용
+	sleep_heap = NULL;
+	sleep_cnt = sleep_cap = 0;
+	next_wakeup = INT64_MAX;
 
 	// mlfqs 용
 	list_init(&all_list);
@@ -162,8 +223,10 @@ thread_init (void) {
 		load_avg = 0; // load_avg 초기화
 	}
 
-	/* Set up a thread structure for the running thread. */
-	initial_thread = running_thread ();
+	/* Set up a thread structure for the running thread.  It stays
+	   on the loader's stack, whose bottom is at a page boundary. */
+	initial_thread = pg_round_down (rrsp ());
+	curr_thread = initial_thread;
 	
 	if (thread_mlfqs){
 		init_thread(initial_thread, "main", 0);
@@ -190,6 +253,10 @@ thread_start (void) {
 
 	/* Wait for the idle thread to initialize idle_thread. */
 	sema_down (&idle_started);
+
+	/* The recent_cpu sweep runs above every MLFQS priority. */
+	if (thread_mlfqs)
+		thread_create ("mlfqs", PRI_MAX, mlfqs_sweep, NULL);
 }
 
 /* Called by the timer interrupt handler at each timer tick.
@@ -213,6 +280,20 @@ thread_tick (void) {
 		intr_yield_on_return ();
 }
 
+/* Charges N timer ticks that elapsed without a timer interrupt
+   to idle time.  Used by the tickless timer. */
+void
+thread_idle_ticks (int64_t n) {
+	idle_ticks += n;
+}
+
+/* Returns the tick at which the next sleeping thread is due, or
+   INT64_MAX if no thread is sleeping. */
+int64_t
+thread_next_wakeup (void) {
+	return next_wakeup;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
@@ -245,12 +326,15 @@ thread_create (const char *name, int priority,
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	uint8_t *kstack;
+	t = thread_alloc (&kstack);
 	if (t == NULL)
 		return TID_ERROR;
 
 	/* Initialize thread. */
 	init_thread (t, name, priority);
+	t->kstack = kstack;
+	t->tf.rsp = (uint64_t) thread_stack_top (t) - sizeof (void *);
 	tid = t->tid = allocate_tid ();
 
 	if(t != initial_thread && t != idle_thread){
@@ -312,7 +396,12 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	list_insert_ordered(&ready_list, &t->elem, thread_priority_less ,NULL); // priority 순으로 삽입
+	if (thread_mlfqs && t->decay_epoch != decay_epoch) {
+		// block 중에 밀린 decay를 깨어날 때 적용.
+		calculating_recent_cpu (t);
+		calculating_therad_priority (t);
+	}
+	ready_queue_push (t); // priority 레벨 큐 뒤에 삽입
 	t->status = THREAD_READY;
 
 	intr_set_level (old_level);
@@ -333,10 +422,9 @@ thread_current (void) {
 	struct thread *t = running_thread ();
 
 	/* Make sure T is really a thread.
-	   If either of these assertions fire, then your thread may
-	   have overflowed its stack.  Each thread has less than 4 kB
-	   of stack, so a few big automatic arrays or moderate
-	   recursion can cause stack overflow. */
+	   If either of these assertions fire, then something has
+	   overwritten your thread's struct thread.  Kernel stack
+	   overflows hit a guard page instead; see thread.h. */
 	ASSERT (is_thread (t));
 	ASSERT (t->status == THREAD_RUNNING);
 
@@ -358,6 +446,7 @@ thread_exit (void) {
 #ifdef USERPROG
 	process_exit ();
 #endif
+	malloc_thread_exit ();
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
@@ -379,19 +468,8 @@ thread_yield (void) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	
-	if (!thread_mlfqs){
-		if (curr != idle_thread){
-			list_insert_ordered(&ready_list, &curr->elem, thread_donation_priority_less, NULL);
-		}
-		list_sort(&ready_list, thread_donation_priority_less, NULL);
-	}
-	else{
-		if(curr != idle_thread){
-			list_insert_ordered(&ready_list, &curr->elem, thread_priority_less, NULL);
-		}
-		list_sort(&ready_list, thread_priority_less, NULL);
-	}
+	if (curr != idle_thread)
+		ready_queue_push (curr);
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
@@ -402,16 +480,15 @@ thread_set_priority (int new_priority) {
 	struct thread *curr = thread_current();
 	enum intr_level old_level = intr_disable();
 	if (!thread_mlfqs){
-	// ready list를 세팅에 따라 priority 순으로 정렬 
 		curr->init_pri = new_priority;
 		donate_set_priority(curr);
-		list_insert_ordered(&ready_list, &curr->elem, thread_priority_less, NULL);
 	}
 	else{
 		curr->priority = new_priority;
 		curr->init_pri = new_priority;
-		list_insert_ordered(&ready_list, &curr->elem, thread_priority_less, NULL);
 	}
+	// 바뀐 priority 레벨 큐에 넣고 재스케줄.
+	ready_queue_push (curr);
 
 	do_schedule(THREAD_READY);
 
@@ -419,47 +496,110 @@ thread_set_priority (int new_priority) {
 
 }
 
+/* Recomputes NEW's effective priority: its own priority, or the
+   highest priority donated through any lock or rwlock it holds.
+   The locks NEW holds are kept in a heap keyed by their top
+   waiter, so this is O(1) in locks and linear in the rwlocks NEW
+   holds, which are few. */
 void
 donate_set_priority(struct thread *new){
 
 	enum intr_level old_level = intr_disable();
-	new->priority = new->init_pri;
-	struct list_elem *e;
-	int big_pri = -1;
+	int priority = new->init_pri;
+
 	//donation에 따라 priority set.
-	
-	if(!list_empty(&new->donation)){
-		for(e = list_front(&new->donation); e != list_end(&new->donation);)
-		{
-
-				if(list_entry(e, struct thread, d_elem)->priority > big_pri){
-					big_pri = list_entry(e, struct thread, d_elem)->priority;
-					}
-				else{
-					e = list_next(e);
-			}
-			}
+	if(!heap_empty(&new->held_locks)){
+		struct lock *top = heap_entry(heap_top(&new->held_locks), struct lock, elem);
+		int donated = lock_donated_priority(top);
+		if(donated > priority)
+			priority = donated;
 	}
-	if(big_pri != -1){
-		new->priority = big_pri;
+	for(struct list_elem *e = list_begin(&new->rw_holds);
+			e != list_end(&new->rw_holds); e = list_next(e)){
+		struct rw_hold *hold = list_entry(e, struct rw_hold, thread_elem);
+		int donated = rwlock_donated_priority(hold->rw);
+		if(donated > priority)
+			priority = donated;
 	}
+	thread_change_priority (new, priority);
 	intr_set_level (old_level);
 
 }
 
-void
-donate_priority(void)
+/* Propagates T's priority, which may just have risen, to the
+   holders of the lock or rwlock T waits on, and on through the
+   locks those holders wait on, until DEPTH reaches 8.  An rwlock
+   has many holders, so the chain forks there and goes on from
+   each holder whose priority changed.  Each step reorders the
+   lock's donor heap and the holder's held-lock heap and stops as
+   soon as a holder's priority does not change.  Returns the
+   deepest level reached.  Must be called with interrupts off. */
+static uint64_t
+donate_chain(struct thread *t, uint64_t depth)
 {
-	struct thread *curr = thread_current();
-	
-	for(int depth = 0; depth < 8;depth++){ 
-		if(curr->wait_on_lock){
-			struct thread *t = curr->wait_on_lock->holder;
+	uint64_t reached = depth;
+
+	ASSERT (intr_get_level () == INTR_OFF);
 
-			t->priority = curr->priority;
-			curr = t;
+	for(; depth < 8; depth++){
+		struct lock *lock = t->wait_on_lock;
+		struct thread *holder;
+		int old_pri;
+
+		// rwlock은 holder가 여럿이라 holder마다 사슬을 따로 이어 감.
+		if(t->wait_on_rw != NULL){
+			struct rwlock *rw = t->wait_on_rw;
+			struct list_elem *e;
+
+			heap_update(&rw->donors, &t->donor_elem);
+			for(e = list_begin(&rw->holders); e != list_end(&rw->holders);
+					e = list_next(e)){
+				uint64_t d = depth + 1;
+
+				holder = list_entry(e, struct rw_hold, elem)->thread;
+				old_pri = holder->priority;
+				donate_set_priority(holder);
+				if(holder->priority != old_pri)
+					d = donate_chain(holder, depth + 1);
+				if(d > reached)
+					reached = d;
+			}
+			break;
 		}
+		if(lock == NULL)
+			break;
+		holder = lock->holder;
+
+		// 방금 풀린 lock이라 아직 새 holder가 없을 수 있음.
+		if(holder == NULL)
+			break;
+
+		heap_update(&lock->donors, &t->donor_elem);
+		heap_update(&holder->held_locks, &lock->elem);
+
+		old_pri = holder->priority;
+		donate_set_priority(holder);
+		reached = depth + 1;
+		if(holder->priority == old_pri)
+			break;
+		t = holder;
 	}
+	return reached;
+}
+
+/* Propagates the current thread's priority along the chain of
+   locks and rwlocks it is waiting on; see donate_chain().  Must
+   be called with interrupts off. */
+void
+donate_priority(void)
+{
+	struct thread *donor = thread_current();
+	uint64_t chain = donate_chain(donor, 0);
+
+	if (chain > donor->stats.donation_depth_max)
+		donor->stats.donation_depth_max = chain;
+	if (chain > sched_stats.donation_depth_max)
+		sched_stats.donation_depth_max = chain;
 
 }
 
@@ -482,12 +622,13 @@ thread_donation_priority_less(const struct list_elem *a, const struct list_elem
     return thread_a->priority > thread_b->priority;
 }
 
+/* Orders waiters in a lock's donor heap by priority. */
 bool
-donation_priority_less(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED){
-	struct thread *thread_a = list_entry(a, struct thread, d_elem);
-    struct thread *thread_b = list_entry(b, struct thread, d_elem);
+donor_priority_less(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED){
+	struct thread *thread_a = heap_entry(a, struct thread, donor_elem);
+	struct thread *thread_b = heap_entry(b, struct thread, donor_elem);
 
-    return thread_a->priority > thread_b->priority;
+	return thread_a->priority < thread_b->priority;
 }
 
 /* Returns the current thread's priority. */
@@ -512,17 +653,10 @@ thread_set_nice (int nice UNUSED) {
 		priority = PRI_MIN;
 	}
 	if(t != idle_thread){
-		t->priority = priority;}
-	if(t != idle_thread){
-		if(t->status == THREAD_READY){
-			enum intr_level old_level = intr_disable();
-			list_remove(&t->elem);
-			list_insert_ordered(&ready_list, &t->elem, thread_priority_less, NULL);
-			intr_set_level(old_level);
-		}
-		else if(t->status == THREAD_RUNNING && 
-		list_entry(list_begin(&ready_list), 
-		struct thread, elem)->priority > t->priority){
+		enum intr_level old_level = intr_disable();
+		thread_change_priority (t, priority);
+		intr_set_level(old_level);
+		if(max_priority() > t->priority){
 			thread_yield();
 		}
 	}
@@ -553,6 +687,9 @@ int
 thread_get_recent_cpu (void) {
 		/* TODO: Your implementation goes here */
 	int value;
+	enum intr_level old_level = intr_disable ();
+	calculating_recent_cpu (thread_current ());
+	intr_set_level (old_level);
 	value = convert_x_n(MULTI_X_N((thread_current()->recent_cpu),(100)));
 	return  value;
 
@@ -566,8 +703,8 @@ thread_get_recent_cpu (void) {
    point it initializes idle_thread, "up"s the semaphore passed
    to it to enable thread_start() to continue, and immediately
    blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   run queue.  It is returned by next_thread_to_run() as a
+   special case when the run queue is empty. */
 static void
 idle (void *idle_started_ UNUSED) {
 	struct semaphore *idle_started = idle_started_;
@@ -581,6 +718,14 @@ idle (void *idle_started_ UNUSED) {
 		intr_disable ();
 		thread_block ();
 
+		/* Use the spare time to zero a free page for a later
+		   PAL_ZERO allocation.  Then block again rather than
+		   halting, so that a thread woken meanwhile runs first. */
+		intr_enable ();
+		if (palloc_zero_idle ())
+			continue;
+		intr_disable ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -593,15 +738,74 @@ idle (void *idle_started_ UNUSED) {
 
 		   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
 		   7.11.1 "HLT Instruction". */
+		timer_idle_enter ();
+		intr_off_end ();
 		asm volatile ("sti; hlt" : : : "memory");
 	}
 }
 
+/* MLFQS recent_cpu sweep thread.  Woken by set_thread_recent_cpu()
+   once per second; decays every runnable thread and recomputes its
+   priority.  Blocked threads are skipped and decayed lazily when
+   they wake, unless they have been asleep long enough that their
+   missed decays are about to fall out of decay_coef[].
+
+   Interrupts are off for only SWEEP_CHUNK threads at a time.  In
+   between, our own all_elem, which is otherwise not in all_list,
+   marks our place, so threads may be created or exit meanwhile.
+   A decay recorded in the middle of a sweep is applied to the
+   rest of this sweep's threads as they are reached, and to the
+   others by the next sweep, since each thread catches up on
+   every epoch it has missed. */
+#define SWEEP_CHUNK 16
+
+static void
+mlfqs_sweep (void *aux UNUSED) {
+	decay_thread = thread_current ();
+	list_remove (&decay_thread->all_elem);
+
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		struct list_elem *e;
+		int n;
+
+		while (sweep_epoch == decay_epoch)
+			thread_block ();
+		sweep_epoch = decay_epoch;
+
+		e = list_begin (&all_list);
+		for (;;) {
+			for (n = 0; n < SWEEP_CHUNK && e != list_end (&all_list);
+					n++, e = list_next (e)) {
+				struct thread *t = list_entry (e, struct thread, all_elem);
+
+				if (t->status == THREAD_BLOCKED
+						&& decay_epoch - t->decay_epoch < DECAY_HIST / 2)
+					continue;
+				calculating_recent_cpu (t);
+				calculating_therad_priority (t);
+			}
+			if (e == list_end (&all_list))
+				break;
+
+			/* Let interrupts in, holding our place. */
+			list_insert (e, &decay_thread->all_elem);
+			intr_enable ();
+			intr_disable ();
+			e = list_next (&decay_thread->all_elem);
+			list_remove (&decay_thread->all_elem);
+		}
+		intr_set_level (old_level);
+	}
+}
+
 /* Function used as the basis for a kernel thread. */
 static void
 kernel_thread (thread_func *function, void *aux) {
 	ASSERT (function != NULL);
 
+	account_switch_in ();
+	intr_off_end ();      /* do_iret already turned interrupts on. */
 	intr_enable ();       /* The scheduler runs with interrupts off. */
 	function (aux);       /* Execute the thread function. */
 	thread_exit ();       /* If function() returns, kill the thread. */
@@ -627,8 +831,11 @@ init_thread (struct thread *t, const char *name, int priority) {
 
 	// donation list 용
 	t->init_pri = priority;
+	t->uquota.limit = user_page_quota;
 	t->wait_on_lock = NULL;
-	list_init (&t->donation);
+	heap_init (&t->held_locks, lock_priority_less, NULL);
+	t->wait_on_rw = NULL;
+	list_init (&t->rw_holds);
 	list_init (&t->child_list);
 
 	// userprog fdt용
@@ -655,6 +862,7 @@ init_thread (struct thread *t, const char *name, int priority) {
 
 	if(thread_mlfqs){
 		// mlfqs용
+		t->decay_epoch = decay_epoch;
 		if(!initial_thread){
 			t->recent_cpu = thread_current()->recent_cpu;
 			t->nice = thread_current()->nice;
@@ -677,10 +885,68 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
+	if (ready_mask == 0)
 		return idle_thread;
 	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+		return ready_queue_pop ();
+}
+
+/* Appends T to the tail of the run queue level for its current
+   priority.  Interrupts must be off. */
+static void
+ready_queue_push (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	list_push_back (&ready_queues[t->priority], &t->elem);
+	ready_mask |= 1ULL << (PRI_MAX - t->priority);
+	ready_cnt++;
+	t->ready_since = rdtsc ();
+}
+
+/* Removes T from the run queue level for its current priority,
+   clearing that level's occupancy bit if it becomes empty. */
+static void
+ready_queue_remove (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	list_remove (&t->elem);
+	if (list_empty (&ready_queues[t->priority]))
+		ready_mask &= ~(1ULL << (PRI_MAX - t->priority));
+	ready_cnt--;
+}
+
+/* Pops the oldest thread of the highest non-empty priority
+   level.  The run queue must not be empty. */
+static struct thread *
+ready_queue_pop (void) {
+	ASSERT (ready_mask != 0);
+
+	int pri = PRI_MAX - __builtin_ctzll (ready_mask);
+	struct thread *t = list_entry (list_front (&ready_queues[pri]),
+			struct thread, elem);
+	ready_queue_remove (t);
+	return t;
+}
+
+/* Sets T's effective priority to PRIORITY.  If T is waiting in
+   the run queue it is moved to the tail of the new level, so
+   nobody ever has to re-sort the run queue.  Interrupts must be
+   off. */
+void
+thread_change_priority (struct thread *t, int priority) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+	if (t->priority == priority)
+		return;
+	if (t->status == THREAD_READY) {
+		ready_queue_remove (t);
+		t->priority = priority;
+		ready_queue_push (t);
+	}
+	else
+		t->priority = priority;
 }
 
 /* Use iretq to launch the thread */
@@ -727,6 +993,8 @@ thread_launch (struct thread *th) {
 	uint64_t tf = (uint64_t) &th->tf;
 	ASSERT (intr_get_level () == INTR_OFF);
 
+	curr_thread = th;
+
 	/* The main switching logic.
 	 * We first restore the whole execution context into the intr_frame
 	 * and then switching to the next thread by calling do_iret.
@@ -791,7 +1059,7 @@ do_schedule(int status) {
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		thread_free (victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
@@ -805,12 +1073,29 @@ schedule (void) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (curr->status != THREAD_RUNNING);
 	ASSERT (is_thread (next));
+
+	/* Leaving idle: put the periodic tick back. */
+	if (curr == idle_thread)
+		timer_idle_exit ();
+
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
 
 	/* Start new time slice. */
 	thread_ticks = 0;
 
+	/* Charge the time NEXT spent in the run queue. */
+	if (next->ready_since != 0) {
+		uint64_t wait = rdtsc () - next->ready_since;
+		next->ready_since = 0;
+		next->stats.rq_wait_cycles += wait;
+		sched_stats.rq_wait_cycles += wait;
+		if (wait > next->stats.rq_wait_max)
+			next->stats.rq_wait_max = wait;
+		if (wait > sched_stats.rq_wait_max)
+			sched_stats.rq_wait_max = wait;
+	}
+
 #ifdef USERPROG
 	/* Activate the new address space. */
 	process_activate (next);
@@ -829,25 +1114,174 @@ schedule (void) {
 			list_push_back (&destruction_req, &curr->elem);
 		}
 
+		next->stats.ctx_switches++;
+		sched_stats.ctx_switches++;
+		switch_start = rdtsc ();
+
 		/* Before switching the thread, we first save the information
 		 * of current running. */
 		thread_launch (next);
+
+		/* We are CURR again, switched back in by someone else. */
+		account_switch_in ();
+	}
+}
+
+/* Charges the context switch that just brought the running
+   thread onto this CPU. */
+static void
+account_switch_in (void) {
+	if (switch_start != 0) {
+		uint64_t cycles = rdtsc () - switch_start;
+		switch_start = 0;
+		running_thread ()->stats.switch_cycles += cycles;
+		sched_stats.switch_cycles += cycles;
+	}
+}
+
+/* Charges CYCLES spent with interrupts disabled to the running
+   thread.  Called by intr_off_end(), possibly before the thread
+   system is initialized. */
+void
+thread_account_intr_off (uint64_t cycles) {
+	struct thread *t = running_thread ();
+
+	sched_stats.intr_off_cycles += cycles;
+	if (cycles > sched_stats.intr_off_max)
+		sched_stats.intr_off_max = cycles;
+	if (is_thread (t)) {
+		t->stats.intr_off_cycles += cycles;
+		if (cycles > t->stats.intr_off_max)
+			t->stats.intr_off_max = cycles;
 	}
 }
 
+/* Charges a lock_acquire() by the running thread that had to
+   wait CYCLES for the lock. */
+void
+thread_account_lock_wait (uint64_t cycles) {
+	struct thread *t = thread_current ();
+
+	t->stats.lock_contended++;
+	t->stats.lock_wait_cycles += cycles;
+	sched_stats.lock_contended++;
+	sched_stats.lock_wait_cycles += cycles;
+}
+
+/* Copies the running thread's scheduler counters into THREAD and
+   the system-wide ones into GLOBAL.  Either may be null. */
+void
+thread_get_sched_stats (struct sched_stats *thread,
+		struct sched_stats *global) {
+	enum intr_level old_level = intr_disable ();
+	if (thread != NULL)
+		*thread = thread_current ()->stats;
+	if (global != NULL)
+		*global = sched_stats;
+	intr_set_level (old_level);
+}
+
+/* Prints the system-wide scheduler latency counters. */
+void
+thread_print_sched_stats (void) {
+	struct sched_stats s;
+
+	thread_get_sched_stats (NULL, &s);
+	printf ("Scheduler: %llu context switches, %llu switch cycles\n",
+			s.ctx_switches, s.switch_cycles);
+	printf ("Scheduler: %llu run queue wait cycles, %llu max\n",
+			s.rq_wait_cycles, s.rq_wait_max);
+	printf ("Scheduler: %llu contended lock acquires, %llu wait cycles, "
+			"donation depth %llu max\n",
+			s.lock_contended, s.lock_wait_cycles, s.donation_depth_max);
+	printf ("Scheduler: %llu interrupts-off cycles, %llu max\n",
+			s.intr_off_cycles, s.intr_off_max);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) {
 	static tid_t next_tid = 1;
 	tid_t tid;
 
-	lock_acquire (&tid_lock);
+	mutex_acquire (&tid_lock);
 	tid = next_tid++;
-	lock_release (&tid_lock);
+	mutex_release (&tid_lock);
 
 	return tid;
 }
 
+/* Returns the address just past the top of T's kernel stack. */
+void *
+thread_stack_top (struct thread *t) {
+	if (t->kstack == NULL)
+		return (uint8_t *) t + PGSIZE;
+	return t->kstack + (KSTACK_PAGES + 1) * PGSIZE;
+}
+
+/* Maps or unmaps the guard page at the bottom of kernel stack
+   region KSTACK. */
+static void
+kstack_set_guard (uint8_t *kstack, bool guard) {
+	uint64_t *pte = pml4e_walk (base_pml4, (uint64_t) kstack, 0);
+
+	ASSERT (pte != NULL && (*pte & PTE_U) == 0);
+	if (guard)
+		*pte &= ~PTE_P;
+	else
+		*pte |= PTE_P;
+	invlpg ((uint64_t) kstack);
+}
+
+/* Obtains a page for a struct thread and a guarded kernel stack,
+   preferably from the thread-object cache.  Stores the stack in
+   *KSTACK and returns the page, or returns a null pointer if
+   memory is exhausted. */
+static struct thread *
+thread_alloc (uint8_t **kstack) {
+	struct thread *t = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	if (!list_empty (&thread_cache)) {
+		t = list_entry (list_pop_front (&thread_cache), struct thread, elem);
+		thread_cache_cnt--;
+	}
+	intr_set_level (old_level);
+	if (t != NULL) {
+		*kstack = t->kstack;
+		return t;
+	}
+
+	t = palloc_get_page (0);
+	*kstack = palloc_get_multiple (0, KSTACK_PAGES + 1);
+	if (t == NULL || *kstack == NULL) {
+		palloc_free_page (t);
+		palloc_free_multiple (*kstack, KSTACK_PAGES + 1);
+		return NULL;
+	}
+	kstack_set_guard (*kstack, true);
+	return t;
+}
+
+/* Returns dead thread T, and its kernel stack, to the
+   thread-object cache, or to the page allocator if the cache is
+   full.  Interrupts must be off. */
+static void
+thread_free (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->kstack != NULL);
+
+	t->magic = 0;
+	if (thread_cache_cnt < THREAD_CACHE_MAX) {
+		list_push_front (&thread_cache, &t->elem);
+		thread_cache_cnt++;
+		return;
+	}
+	kstack_set_guard (t->kstack, false);
+	palloc_free_multiple (t->kstack, KSTACK_PAGES + 1);
+	palloc_free_page (t);
+}
+
 
 void
 thread_sleep(int64_t tick) {
@@ -855,8 +1289,14 @@ thread_sleep(int64_t tick) {
 	enum intr_level old_level = intr_disable();
 	struct thread *curr = thread_current ();
 	if (curr != idle_thread) {
+		// heap이 꽉 찼으면 interrupt를 켜고 키운 뒤 다시 확인.
+		while (sleep_cnt == sleep_cap) {
+			intr_set_level (old_level);
+			sleep_heap_grow ();
+			old_level = intr_disable ();
+		}
 		curr->ticks = tick;
-		list_push_back (&sleep_list, &curr->elem);
+		sleep_heap_push (curr);
 		thread_block();
 	}
 
@@ -864,34 +1304,105 @@ thread_sleep(int64_t tick) {
 
 }
 
+/* Called from the timer interrupt.  Wakes every sleeping thread
+   whose wake-up tick is at or before TICKS.  Costs O(1) when
+   nobody is due and O(k log n) when K of N sleepers wake. */
 void
 thread_wake_up(int64_t ticks){
 
-	if(list_empty(&sleep_list))
+	if (ticks < next_wakeup)
 		return;
-	
-    struct list_elem *e;
-
-		for (e = list_begin(&sleep_list); e != list_end(&sleep_list);)
-		{
-			struct thread *t = list_entry(e, struct thread, elem);
-			
-			if (ticks >= t->ticks)
-			{
-				e = list_remove(e);
-				thread_unblock(t);
-			}
-			else{
-				e = list_next(e);
-			}
-		}
+
+	while (sleep_cnt > 0 && sleep_heap[0]->ticks <= ticks)
+		thread_unblock (sleep_heap_pop ());
+}
+
+/* Doubles the capacity of sleep_heap.  Must be called with
+   interrupts on, since palloc may sleep. */
+static void
+sleep_heap_grow (void) {
+	size_t old_cap = sleep_cap;
+	size_t new_cap = old_cap ? old_cap * 2 : PGSIZE / sizeof *sleep_heap;
+	size_t new_pages = new_cap * sizeof *sleep_heap / PGSIZE;
+	struct thread **new_heap, **old_heap;
+	enum intr_level old_level;
+
+	ASSERT (intr_get_level () == INTR_ON);
+
+	new_heap = palloc_get_multiple (0, new_pages);
+	if (new_heap == NULL)
+		PANIC ("out of memory growing the sleep queue");
+
+	old_level = intr_disable ();
+	if (sleep_cap != old_cap) {
+		/* Somebody else grew it while we were allocating. */
+		intr_set_level (old_level);
+		palloc_free_multiple (new_heap, new_pages);
+		return;
+	}
+	old_heap = sleep_heap;
+	memcpy (new_heap, old_heap, sleep_cnt * sizeof *sleep_heap);
+	sleep_heap = new_heap;
+	sleep_cap = new_cap;
+	intr_set_level (old_level);
+
+	if (old_heap != NULL)
+		palloc_free_multiple (old_heap, old_cap * sizeof *sleep_heap / PGSIZE);
+}
+
+/* Inserts T into sleep_heap by T->ticks.  There must be room. */
+static void
+sleep_heap_push (struct thread *t) {
+	size_t i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (sleep_cnt < sleep_cap);
+
+	/* Sift up. */
+	for (i = sleep_cnt++; i > 0; i = (i - 1) / 2) {
+		struct thread *parent = sleep_heap[(i - 1) / 2];
+		if (parent->ticks <= t->ticks)
+			break;
+		sleep_heap[i] = parent;
+	}
+	sleep_heap[i] = t;
+	next_wakeup = sleep_heap[0]->ticks;
+}
+
+/* Removes and returns the thread with the earliest wake-up tick.
+   sleep_heap must not be empty. */
+static struct thread *
+sleep_heap_pop (void) {
+	struct thread *min, *last;
+	size_t i, child;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (sleep_cnt > 0);
+
+	min = sleep_heap[0];
+	last = sleep_heap[--sleep_cnt];
+
+	/* Sift LAST down from the root. */
+	for (i = 0; (child = 2 * i + 1) < sleep_cnt; i = child) {
+		if (child + 1 < sleep_cnt
+				&& sleep_heap[child + 1]->ticks < sleep_heap[child]->ticks)
+			child++;
+		if (last->ticks <= sleep_heap[child]->ticks)
+			break;
+		sleep_heap[i] = sleep_heap[child];
+	}
+	if (sleep_cnt > 0)
+		sleep_heap[i] = last;
+
+	next_wakeup = sleep_cnt > 0 ? sleep_heap[0]->ticks : INT64_MAX;
+	return min;
 }
 
 
 void
 calculating_therad_priority(struct thread *t){
 
-	if(t == idle_thread){
+	if(t == idle_thread || t == decay_thread){
 		return ;
 	}
 	int priority = PRI_MAX - convert_x_n(DIVI_X_N(t->recent_cpu,4)) - t->nice*2;
@@ -901,85 +1412,87 @@ calculating_therad_priority(struct thread *t){
 	if(priority > 63){
 		priority = 63;
 	}
-	t->priority = priority;
+	thread_change_priority (t, priority);
 
 
 }
 
 
+/* Called from the timer interrupt once per second.  O(1): the
+   run queue keeps its own count of ready threads. */
 void
 calculating_load_avg(void){
 	
-	int size= list_size(&ready_list);;
+	int size = ready_cnt;
+	struct thread *curr = thread_current ();
 
-	if(thread_current() != idle_thread){
+	if(curr != idle_thread && curr != decay_thread){
 		size +=1;
 	}
+	if(decay_thread != NULL && decay_thread->status == THREAD_READY){
+		size -=1;
+	}
 
 	load_avg = DIVI_X_N(ADD_X_N(MULTI_X_N(load_avg,59),size),60);
 
 }
 
+/* Applies every once-per-second decay T has missed since its
+   last one.  Interrupts must be off. */
 void
 calculating_recent_cpu(struct thread *t){
 
-	/* TODO: Your implementation goes here */
-	if(t == idle_thread){
+	if(t == idle_thread || t == decay_thread){
+		t->decay_epoch = decay_epoch;
 		return ;
 	}
-	
-	int load = MULTI_X_N(load_avg, 2);
-	int coef = DIVI_X_Y(load,ADD_X_N(load,1));
+	ASSERT (decay_epoch - t->decay_epoch < DECAY_HIST);
 
-	t->recent_cpu = 
-		ADD_X_N(
-			MULTI_X_Y(coef,t->recent_cpu),(t->nice)); 
-	
+	while (t->decay_epoch != decay_epoch) {
+		int coef = decay_coef[++t->decay_epoch % DECAY_HIST];
 
+		t->recent_cpu = 
+			ADD_X_N(
+				MULTI_X_Y(coef,t->recent_cpu),(t->nice)); 
+	}
 
 }
 
+/* Called from the timer interrupt once per second, after
+   calculating_load_avg().  Records this second's decay
+   coefficient and hands the sweep over to decay_thread. */
 void
 set_thread_recent_cpu(void){
-	enum intr_level old_level = intr_disable();
-	struct list_elem *e;
+	ASSERT (intr_get_level () == INTR_OFF);
 
-	for(e = list_begin(&all_list); e != list_end(&all_list);e = list_next(e)){
+	int load = MULTI_X_N(load_avg, 2);
+	int coef = DIVI_X_Y(load,ADD_X_N(load,1));
 
-		struct thread *t = list_entry(e, struct thread, all_elem);
-		calculating_recent_cpu(t);
-		
+	decay_coef[++decay_epoch % DECAY_HIST] = coef;
 
+	if (decay_thread != NULL && decay_thread->status == THREAD_BLOCKED) {
+		thread_unblock (decay_thread);
+		intr_yield_on_return ();
 	}
-
-	intr_set_level(old_level);
 }
 
+/* Called from the timer interrupt every fourth tick.  Between
+   decays only the running thread's recent_cpu changes, so it is
+   the only priority that needs recomputing. */
 void
 set_thread_priority(void){
 
 	enum intr_level old_level = intr_disable();
-	struct list_elem *e;
-
-	for(e = list_begin(&all_list); e != list_end(&all_list);e = list_next(e)){
-
-		struct thread *t = list_entry(e, struct thread, all_elem);
-		calculating_therad_priority(t);
-
-	}
+	calculating_therad_priority(thread_current ());
 	intr_set_level(old_level);
 
 }
 
 int 
 max_priority(void){
-  int priority = -1;
-  struct thread* t;
-  if (!list_empty(&ready_list)) {
-      t = list_entry(list_front(&ready_list), struct thread, elem);
-      priority = t->priority;
-  }
-  return priority;
+  if (ready_mask == 0)
+      return -1;
+  return PRI_MAX - __builtin_ctzll (ready_mask);
 }
 
 
@@ -999,7 +1512,7 @@ int convert_x_n(const signed int x){
 
 void
 increment_recent_cpu(void){
-	if(thread_current() != idle_thread){
+	if(thread_current() != idle_thread && thread_current() != decay_thread){
 		thread_current()->recent_cpu = ADD_X_N(thread_current()->recent_cpu,1);
 	}
 
@@ -2,8 +2,11 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
 #include "threads/interrupt.h"
+#include "threads/mmu.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "intrinsic.h"
 
 /* Number of page faults processed. */
@@ -121,8 +124,9 @@ page_fault (struct intr_frame *f) {
 	bool not_present;  /* True: not-present page, false: writing r/o page. */
 	bool write;        /* True: access was write, false: access was read. */
 	bool user;         /* True: access by user, false: access by kernel. */
-	bool null_ptr; /* True : null이 아님, false : null 포인터임.*/
-	bool kern_base_up; // true : 커널 가상 주소 공간 내, false: 커널 가상 주소 공간 바깥.
+	bool null_ptr = false; /* True : null이 아님, false : null 포인터임.*/
+	bool kern_base_up = false; // true : 커널 가상 주소 공간 내, false: 커널 가상 주소 공간 바깥.
+	bool holds_rwlock; // true : rwlock을 잡은 채로 fault.
 	
 	void *fault_addr;  /* Fault address. */
 
@@ -148,6 +152,13 @@ page_fault (struct intr_frame *f) {
 	if(fault_addr == NULL ){ null_ptr = true;}
 	if(fault_addr >= KERN_BASE ){kern_base_up = true;}
 
+	/* A write to a page shared copy-on-write by fork(), by the
+	   process itself or by the kernel on its behalf. */
+	if (!not_present && write && is_user_vaddr (fault_addr)
+			&& thread_current ()->pml4 != NULL
+			&& pml4_break_cow (thread_current ()->pml4, fault_addr))
+		return;
+
 #ifdef VM
 	/* For project 3 and later. */
 	if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
@@ -157,7 +168,16 @@ page_fault (struct intr_frame *f) {
 	/* Count page faults. */
 	page_fault_cnt++;
 
-	if( null_ptr || kern_base_up){
+	// rwlock을 잡은 채로 exit하면 readers 수와 rw_hold가 그대로 남는다.
+	// 시스템 콜은 락을 잡기 전에 버퍼를 검사하므로 여기 오면 커널 버그.
+	holds_rwlock = !list_empty (&thread_current ()->rw_holds);
+
+	if( (null_ptr || kern_base_up) && !holds_rwlock){
+		exit(-1);
+	}
+	// 시스템 콜이 사용자의 읽기 전용 페이지에 쓰려고 한 경우.
+	if (!user && !not_present && write && is_user_vaddr (fault_addr)
+			&& !holds_rwlock) {
 		exit(-1);
 	}
 	/* If the fault is true fault, show info and exit. */
@@ -78,7 +78,8 @@ process_create_initd (const char *file_name) {
 static void
 initd (void *f_name) {
 #ifdef VM
-	supplemental_page_table_init (&thread_current ()->spt);
+	if (!supplemental_page_table_init (&thread_current ()->spt))
+		PANIC("Fail to launch initd\n");
 #endif
 
 	process_init ();
@@ -134,13 +135,19 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 		return false;
 	}
 
-	newpage = palloc_get_page(PAL_USER | PAL_ZERO);
+	// 부모의 프레임을 그대로 공유한다. 쓰기 가능한 페이지는 양쪽 모두
+	// copy-on-write가 되고, 처음 쓰는 쪽이 page fault에서 복사한다.
+	if (pml4_share_page (current->pml4, parent->pml4, va))
+		return true;
+
+	// 더 공유할 수 없는 프레임이면 예전처럼 바로 복사한다.
+	newpage = palloc_get_page(PAL_USER);
 	if(newpage == NULL){
 		return false;
 	}
 
-	memcpy(newpage, parent_page, PGSIZE);
-	writable = is_writable(pte);
+	page_copy (newpage, parent_page);
+	writable = is_writable(pte) || (*pte & PTE_COW);
 
 	if(!pml4_set_page(current->pml4,va, newpage,writable)){
 
@@ -176,10 +183,14 @@ __do_fork (void *aux) {
 		goto error;
 
 	}
+	// 부모의 user page quota와 예약을 물려받음.
+	if (!palloc_set_quota (parent->uquota.limit, parent->uquota.reserve))
+		goto error;
 
 	process_activate (current);
 #ifdef VM
-	supplemental_page_table_init (&current->spt);
+	if (!supplemental_page_table_init (&current->spt))
+		goto error;
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
 #else
@@ -266,11 +277,20 @@ process_exec (void *f_name) {
 
 	/* We first kill the current context */
 	process_cleanup ();
+#ifdef VM
+	// cleanup에서 비운 SPT를 새 프로그램용으로 다시 준비.
+	if (!supplemental_page_table_init (&thread_current ()->spt)) {
+		palloc_free_page (file_name);
+		thread_current ()->exec_page = NULL;
+		return -1;
+	}
+#endif
 
 	/* And then load the binary */
 	success = load (file_name, &_if);
 	/* If load failed, quit. */
 	palloc_free_page (file_name);
+	thread_current ()->exec_page = NULL;
 	if (!success)
 		return -1;
 
@@ -399,7 +419,10 @@ process_exit (void) {
 		}
 	}
 	sema_down(&cur->free_wait);
+	palloc_free_page (cur->exec_page); // exec 도중 죽었으면 남아있음.
+	cur->exec_page = NULL;
 	process_cleanup ();
+	palloc_set_quota (cur->uquota.limit, 0); // 남은 예약 반납.
 
 }
 
@@ -767,13 +790,6 @@ install_page (void *upage, void *kpage, bool writable) {
  * If you want to implement the function for only project 2, implement it on the
  * upper block. */
 
-static bool
-lazy_load_segment (struct page *page, void *aux) {
-	/* TODO: Load the segment from the file */
-	/* TODO: This called when the first page fault occurs on address VA. */
-	/* TODO: VA is available when calling this function. */
-}
-
 /* Loads a segment starting at offset OFS in FILE at address
  * UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual
  * memory are initialized, as follows:
@@ -795,25 +811,10 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
-	while (read_bytes > 0 || zero_bytes > 0) {
-		/* Do calculate how to fill this page.
-		 * We will read PAGE_READ_BYTES bytes from FILE
-		 * and zero the final PAGE_ZERO_BYTES bytes. */
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		void *aux = NULL;
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, aux))
-			return false;
-
-		/* Advance. */
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		upage += PGSIZE;
-	}
-	return true;
+	/* The segment becomes one area of the supplemental page table,
+	 * whose pages are read in when they are first touched. */
+	return vm_area_map (&thread_current ()->spt, upage,
+			read_bytes + zero_bytes, writable, VM_ANON, file, ofs, read_bytes);
 }
 
 /* Create a PAGE of stack at the USER_STACK. Return true on success. */
@@ -822,10 +823,14 @@ setup_stack (struct intr_frame *if_) {
 	bool success = false;
 	void *stack_bottom = (void *) (((uint8_t *) USER_STACK) - PGSIZE);
 
-	/* TODO: Map the stack on stack_bottom and claim the page immediately.
-	 * TODO: If success, set the rsp accordingly.
-	 * TODO: You should mark the page is stack. */
-	/* TODO: Your code goes here */
+	/* The stack is an area of its own, so that it can grow down
+	 * later.  Its first page is claimed now, for the arguments. */
+	if (vm_area_map (&thread_current ()->spt, stack_bottom, PGSIZE, true,
+				VM_ANON, NULL, 0, 0)
+			&& vm_claim_page (stack_bottom)) {
+		if_->rsp = USER_STACK;
+		success = true;
+	}
 
 	return success;
 }
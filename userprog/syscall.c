@@ -17,10 +17,13 @@
 #include "lib/kernel/stdio.h"
 #include "lib/string.h"
 
-struct lock filesys_lock;
+struct rwlock filesys_lock;
 typedef int pid_t;
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
+static int do_read (int fd, void *buffer, unsigned size);
+static void check_buffer_writable (void *buffer, unsigned size);
+static int do_write (int fd, const void *buffer, unsigned size);
 
 
 /* System call.
@@ -48,7 +51,7 @@ syscall_init (void) {
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 
-	lock_init(&filesys_lock);
+	rwlock_init(&filesys_lock);
 }
 
 
@@ -129,6 +132,14 @@ syscall_handler (struct intr_frame *f) {
 		close((int)f->R.rdi);
 		break;
 		}
+	case SYS_SCHEDSTAT:{
+		f->R.rax = schedstat((struct sched_stats *)f->R.rdi, (struct sched_stats *)f->R.rsi);
+		break;
+	}
+	case SYS_MEMQUOTA:{
+		f->R.rax = memquota((size_t)f->R.rdi, (size_t)f->R.rsi);
+		break;
+	}
 	default:
 		exit(-1);
 		break;
@@ -152,11 +163,69 @@ check_address(const uint64_t *addr){
 	if(!is_user_vaddr(addr)){
 		exit(-1);
 	}
+#ifdef VM
+	// 아직 올라오지 않은 페이지도 SPT에 있으면 유효하다.
+	// filesys_lock을 잡기 전에 미리 올려 둔다.
+	if(vm_claim_page((void *) addr)){
+		return;
+	}
+#endif
 	if(pml4_get_page(thread_current()->pml4, addr) == NULL){
 		exit(-1);
 	}
 }
 
+// BUFFER부터 SIZE 바이트가 걸친 모든 페이지를 check_address로 확인.
+void
+check_address_string(const void *buffer, unsigned size){
+	const uint8_t *p = buffer;
+	const uint8_t *end = p + size;
+
+	if(size == 0){
+		return;
+	}
+	if(end < p){
+		exit(-1);
+	}
+	for(p = pg_round_down(p); p < end; p += PGSIZE){
+		check_address((const uint64_t *) p);
+	}
+}
+
+// 커널이 BUFFER에 SIZE 바이트를 쓸 수 있는지 filesys_lock을 잡기 전에 확인.
+// CR0.WP 때문에 읽기 전용 페이지에 쓰면 커널도 fault가 나는데,
+// 락을 잡은 채로 fault 핸들러에서 exit하면 rwlock이 풀리지 않는다.
+// fork가 공유한 COW 페이지는 여기서 미리 복사해 둔다.
+static void
+check_buffer_writable(void *buffer, unsigned size){
+	uint64_t *pml4 = thread_current()->pml4;
+	uint8_t *p = buffer;
+	uint8_t *end = p + size;
+
+	for(p = pg_round_down(p); p < end; p += PGSIZE){
+#ifdef VM
+		struct page *page = spt_get_page(&thread_current()->spt, p);
+		if(page != NULL){
+			// 공유 frame은 vm_pin_buffer가 떼어낸다.
+			if(!page->writable){
+				exit(-1);
+			}
+			continue;
+		}
+#endif
+		uint64_t *pte = pml4e_walk(pml4, (uint64_t) p, false);
+		if(pte == NULL || !(*pte & PTE_P)){
+			exit(-1);
+		}
+		if(is_writable(pte)){
+			continue;
+		}
+		if(!(*pte & PTE_COW) || !pml4_break_cow(pml4, p)){
+			exit(-1);
+		}
+	}
+}
+
 
 void
 halt (void) {
@@ -183,7 +252,9 @@ exec (const char *file) {
 	if(f_name_copy == NULL){
 		exit(-1);
 	}
-	strlcpy(f_name_copy, file, strlen(file)+1);
+	// 복사 중 fault로 죽어도 process_exit에서 해제되도록 먼저 기록.
+	thread_current()->exec_page = f_name_copy;
+	strlcpy(f_name_copy, file, PGSIZE);
 
 	tid = process_exec((void *)f_name_copy);
 	if(tid == -1){
@@ -202,9 +273,9 @@ wait (pid_t pid) {
 bool
 create (const char *file, unsigned initial_size) {
 	check_address(file);
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	bool is_create = filesys_create(file, initial_size);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	return is_create;
 
 }
@@ -213,9 +284,9 @@ bool
 remove (const char *file) {
 	check_address(file);
 	// 바로 삭제하지 않고 열려있다면 그 파일은 close가 되지 않도록 처리.
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	bool is_remove = filesys_remove(file);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	return is_remove;
 
 }
@@ -223,9 +294,9 @@ remove (const char *file) {
 int
 open (const char *file) {
 	check_address(file);
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	struct file *open_n = filesys_open(file);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 	if(open_n == NULL){
 		return -1;
 	}
@@ -251,38 +322,57 @@ int
 filesize (int fd) {
 
 	struct file *target_file = thread_current()->fdt[fd];
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_read(&filesys_lock);
 	off_t size = file_length(target_file);
-	lock_release(&filesys_lock);
+	rwlock_release_read(&filesys_lock);
 	return size;
 }
 
 int
 read (int fd, void *buffer, unsigned size) {
+	int result;
 
 	check_address(buffer);
 	check_address_string(buffer, size);
+	check_buffer_writable(buffer, size);
 
-	lock_acquire(&filesys_lock);
+#ifdef VM
+	// 파일을 읽는 동안 버퍼의 frame이 쫓겨나지 않도록 고정한다.
+	// filesys_lock을 잡은 채로 page fault가 나면 eviction과 교착될 수 있다.
+	if(!vm_pin_buffer(buffer, size, true)){
+		exit(-1);
+	}
+#endif
+	result = do_read(fd, buffer, size);
+#ifdef VM
+	vm_unpin_buffer(buffer, size);
+#endif
+	return result;
+}
+
+static int
+do_read (int fd, void *buffer, unsigned size) {
+	rwlock_acquire_read(&filesys_lock);
 	if(fd == 0){
 		unsigned count = size;
 		while(count--)
 			*((char *)buffer++)= input_getc();
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 		return size;
 	}
 	else if(fd == 1){
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 		return -1;
 	}
 	
 	if(fd <64){
 		struct file *target_file = thread_current()->fdt[fd];
 		off_t byte_read =  file_read(target_file,buffer,size);
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 		return byte_read;
 		}
 	else{
+		rwlock_release_read(&filesys_lock);
 		exit(-1);
 		// 64 이상이나 이하의 fd를 가져왔다면 리턴.
 		// 또 target_file 자체가 존재하는지도 확인해야함.
@@ -295,11 +385,28 @@ read (int fd, void *buffer, unsigned size) {
 
 int
 write (int fd, const void *buffer, unsigned size) {
+	int result;
+
 	check_address(buffer);
-	lock_acquire(&filesys_lock);
+
+#ifdef VM
+	if(!vm_pin_buffer(buffer, size, false)){
+		exit(-1);
+	}
+#endif
+	result = do_write(fd, buffer, size);
+#ifdef VM
+	vm_unpin_buffer(buffer, size);
+#endif
+	return result;
+}
+
+static int
+do_write (int fd, const void *buffer, unsigned size) {
+	rwlock_acquire_write(&filesys_lock);
 
 	if(fd >64 || fd <0){
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		exit(-1);
 
 	}
@@ -315,25 +422,25 @@ write (int fd, const void *buffer, unsigned size) {
         // 	ptr++; // 다음 바이트로 이동
 		// }
 		putbuf(buffer, size);
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		return size;
 	}
 	else if(fd == 0){
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		return -1;
 	}
 	else if(!is_user_vaddr(buffer+size)){
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		exit(-1);
 	}
 	else{
 		struct file *target_file = thread_current()->fdt[fd];
 		if(target_file == NULL){
-			lock_release(&filesys_lock);
+			rwlock_release_write(&filesys_lock);
 			return -1;
 		}
 		off_t byte_write = file_write(target_file,buffer,size);
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 		return byte_write;
 	}
 	// 뭘해도 write bad ptr이 안 낫네..
@@ -347,18 +454,18 @@ seek (int fd, unsigned position) {
 		return ;
 	}
 	else{
-		lock_acquire(&filesys_lock);
+		rwlock_acquire_write(&filesys_lock);
 		file_seek(target_file, position);
-		lock_release(&filesys_lock);
+		rwlock_release_write(&filesys_lock);
 	}
 }
 
 unsigned
 tell (int fd) {
 	struct file *target_file = thread_current()->fdt[fd];
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_read(&filesys_lock);
 	off_t position = file_tell(target_file);
-	lock_release(&filesys_lock);
+	rwlock_release_read(&filesys_lock);
 	return (unsigned)position;
 }
 
@@ -379,9 +486,39 @@ close (int fd) {
 	}
 
 	thread_current()->fdt[fd] = NULL; // 닫았으니 null로 초기화 
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 	file_close(target_file);
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
+}
+
+int
+schedstat (struct sched_stats *thread, struct sched_stats *global) {
+	// 유저 버퍼 양 끝을 모두 확인.
+	if(thread != NULL){
+		check_address((const uint64_t *)thread);
+		check_address((const uint64_t *)((char *)(thread + 1) - 1));
+	}
+	if(global != NULL){
+		check_address((const uint64_t *)global);
+		check_address((const uint64_t *)((char *)(global + 1) - 1));
+	}
+	// 인터럽트를 끈 채로 유저 페이지에 쓰면 copy-on-write fault를
+	// 처리할 수 없으므로, 커널 스택에 받아 온 뒤 복사한다.
+	struct sched_stats t, g;
+	thread_get_sched_stats(&t, &g);
+	if(thread != NULL)
+		*thread = t;
+	if(global != NULL)
+		*global = g;
+	return 0;
+}
+
+// 현재 프로세스의 user page 한도를 LIMIT, 예약을 RESERVE 페이지로 바꿈.
+// exec 후에도 유지되고 fork한 자식이 물려받음. 한도는 낮추기만 할 수 있고,
+// 모든 프로세스의 예약 합이 -ur 상한을 넘거나 예약할 여유가 없으면 -1.
+int
+memquota (size_t limit, size_t reserve) {
+	return palloc_set_quota(limit, reserve) ? 0 : -1;
 }
 
 int dup2(int oldfd, int newfd){
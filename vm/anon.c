@@ -2,6 +2,14 @@
 
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include <bitmap.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -17,11 +25,58 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* Swap area.
+ *
+ * The swap disk is divided into page-sized slots of
+ * SECTORS_PER_PAGE sectors each, and SWAP_SLOTS has a bit for
+ * each slot that is in use.  A swapped-out page remembers its
+ * slot; the slot is freed when the page is swapped back in or
+ * destroyed, which includes when its process exits.  A frame that
+ * fork() shared between processes is written once, and all of its
+ * pages take the same slot, which is freed when the last of them
+ * lets it go.
+ *
+ * The eviction code writes several anonymous pages at a time
+ * through anon_swap_out_batch(), which gives them consecutive
+ * slots when it can and writes them in slot order, so that the
+ * disk head sweeps across them once instead of seeking back and
+ * forth between scattered slots. */
+
+/* Sectors in a slot. */
+#define SECTORS_PER_PAGE (PGSIZE / DISK_SECTOR_SIZE)
+
+static struct bitmap *swap_slots;   /* Slots in use. */
+static uint16_t *slot_shares;       /* Pages in each slot beyond the
+                                       first. */
+static struct lock swap_lock;       /* Protects swap_slots and
+                                       slot_shares. */
+
+/* Statistics. */
+static long long swap_out_cnt;      /* Pages written. */
+static long long swap_batch_cnt;    /* Batches written. */
+static long long swap_in_cnt;       /* Pages read. */
+static int64_t swap_ticks;          /* Timer ticks spent in swap I/O. */
+
+static size_t slot_alloc (size_t cnt);
+static void slot_free (size_t slot);
+static void slot_write (size_t slot, const void *kva);
+static void slot_read (size_t slot, void *kva);
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
-	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	/* Without a swap disk, anonymous pages are never evicted. */
+	swap_disk = disk_get (1, 1);
+	lock_init (&swap_lock);
+	swap_slots = NULL;
+	slot_shares = NULL;
+	if (swap_disk != NULL) {
+		size_t slot_cnt = disk_size (swap_disk) / SECTORS_PER_PAGE;
+		swap_slots = bitmap_create (slot_cnt);
+		slot_shares = calloc (slot_cnt, sizeof *slot_shares);
+		if (swap_slots == NULL || slot_shares == NULL)
+			PANIC ("swap: out of memory for slot tables");
+	}
 }
 
 /* Initialize the file mapping */
@@ -31,22 +86,180 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->slot = BITMAP_ERROR;
+	return true;
 }
 
 /* Swap in the page by read contents from the swap disk. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+
+	/* A page that was never swapped out starts out zeroed. */
+	if (anon_page->slot == BITMAP_ERROR) {
+		page_zero (kva);
+		return true;
+	}
+
+	slot_read (anon_page->slot, kva);
+	slot_free (anon_page->slot);
+	anon_page->slot = BITMAP_ERROR;
+	swap_in_cnt++;
+	return true;
 }
 
 /* Swap out the page by writing contents to the swap disk. */
 static bool
 anon_swap_out (struct page *page) {
+	return anon_swap_out_batch (&page, 1);
+}
+
+/* Swaps out the CNT anonymous PAGES, which must be resident and
+ * unmapped, in one pass.  Gives them consecutive slots if it can,
+ * and otherwise any free slots, and writes them in slot order.
+ * Returns false, writing nothing, if there are fewer than CNT
+ * free slots. */
+bool
+anon_swap_out_batch (struct page *pages[], size_t cnt) {
+	struct page *order[SWAP_BATCH];
+	size_t first, i, j;
+	int64_t start;
+
+	ASSERT (cnt > 0 && cnt <= SWAP_BATCH);
+
+	first = slot_alloc (cnt);
+	if (first != BITMAP_ERROR) {
+		for (i = 0; i < cnt; i++)
+			pages[i]->anon.slot = first + i;
+	} else {
+		for (i = 0; i < cnt; i++) {
+			pages[i]->anon.slot = slot_alloc (1);
+			if (pages[i]->anon.slot == BITMAP_ERROR) {
+				while (i-- > 0) {
+					slot_free (pages[i]->anon.slot);
+					pages[i]->anon.slot = BITMAP_ERROR;
+				}
+				return false;
+			}
+		}
+	}
+
+	/* Sort by slot, by insertion, since CNT is small. */
+	for (i = 0; i < cnt; i++) {
+		for (j = i; j > 0 && order[j - 1]->anon.slot > pages[i]->anon.slot; j--)
+			order[j] = order[j - 1];
+		order[j] = pages[i];
+	}
+
+	start = timer_ticks ();
+	for (i = 0; i < cnt; i++)
+		slot_write (order[i]->anon.slot, order[i]->frame->kva);
+	swap_ticks += timer_elapsed (start);
+	swap_out_cnt += cnt;
+	swap_batch_cnt++;
+	return true;
+}
+
+/* Puts PAGE, an anonymous page that shared a frame with SRC,
+ * into the slot that SRC was just swapped out to.  PAGE must be
+ * unmapped and have no slot of its own. */
+void
+anon_swap_share (struct page *page, struct page *src) {
+	ASSERT (page->anon.slot == BITMAP_ERROR);
+	ASSERT (src->anon.slot != BITMAP_ERROR);
+
+	lock_acquire (&swap_lock);
+	ASSERT (slot_shares[src->anon.slot] < UINT16_MAX);
+	slot_shares[src->anon.slot]++;
+	lock_release (&swap_lock);
+	page->anon.slot = src->anon.slot;
+}
+
+/* Reads the contents of PAGE, which must be swapped out, into
+ * KVA, leaving PAGE swapped out.  Used by fork() to copy a page
+ * that the parent does not have in memory. */
+bool
+anon_swap_copy (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->slot == BITMAP_ERROR)
+		return false;
+	slot_read (anon_page->slot, kva);
+	return true;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->slot != BITMAP_ERROR) {
+		slot_free (anon_page->slot);
+		anon_page->slot = BITMAP_ERROR;
+	}
+}
+
+/* Prints swap statistics. */
+void
+vm_anon_print_stats (void) {
+	long long pages = swap_out_cnt + swap_in_cnt;
+
+	/* I/O that all finished within one tick is counted as taking a
+	 * tick, which makes the rate a lower bound. */
+	int64_t ticks = swap_ticks > 0 ? swap_ticks : 1;
+
+	if (swap_slots == NULL)
+		return;
+	printf ("Swap: %lld pages out in %lld batches, %lld pages in, "
+			"%lld pages/s\n", swap_out_cnt, swap_batch_cnt, swap_in_cnt,
+			pages * TIMER_FREQ / ticks);
+}
+
+/* Marks CNT consecutive free slots used and returns the first,
+ * or returns BITMAP_ERROR if there are none. */
+static size_t
+slot_alloc (size_t cnt) {
+	size_t slot;
+
+	if (swap_slots == NULL)
+		return BITMAP_ERROR;
+	lock_acquire (&swap_lock);
+	slot = bitmap_scan_and_flip (swap_slots, 0, cnt, false);
+	lock_release (&swap_lock);
+	return slot;
+}
+
+/* Lets go of SLOT, marking it free unless other pages are still
+ * in it. */
+static void
+slot_free (size_t slot) {
+	lock_acquire (&swap_lock);
+	ASSERT (bitmap_test (swap_slots, slot));
+	if (slot_shares[slot] > 0)
+		slot_shares[slot]--;
+	else
+		bitmap_reset (swap_slots, slot);
+	lock_release (&swap_lock);
+}
+
+/* Writes the page at KVA to SLOT. */
+static void
+slot_write (size_t slot, const void *kva) {
+	size_t i;
+
+	for (i = 0; i < SECTORS_PER_PAGE; i++)
+		disk_write (swap_disk, slot * SECTORS_PER_PAGE + i,
+				(const uint8_t *) kva + i * DISK_SECTOR_SIZE);
+}
+
+/* Reads SLOT into the page at KVA. */
+static void
+slot_read (size_t slot, void *kva) {
+	int64_t start = timer_ticks ();
+	size_t i;
+
+	for (i = 0; i < SECTORS_PER_PAGE; i++)
+		disk_read (swap_disk, slot * SECTORS_PER_PAGE + i,
+				(uint8_t *) kva + i * DISK_SECTOR_SIZE);
+	swap_ticks += timer_elapsed (start);
 }
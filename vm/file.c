@@ -55,4 +55,5 @@ do_mmap (void *addr, size_t length, int writable,
 /* Do the munmap */
 void
 do_munmap (void *addr) {
+	vm_area_unmap (&thread_current ()->spt, addr);
 }
@@ -1,9 +1,40 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <round.h>
+#include <string.h>
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/slab.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
 
+/* Caches of `struct page's and `struct frame's. */
+static struct kmem_cache *vm_page_cache;
+static struct kmem_cache *vm_frame_cache;
+
+/* Frame table: every frame that holds a user page, in the order
+ * the clock hand visits them.  FRAME_LOCK protects the list, the
+ * hand, each frame's pin count, and the link between a page and
+ * its frame.  It is held across a whole eviction, so a page
+ * cannot be freed while its frame is being swapped out. */
+static struct list frame_table;
+static struct list_elem *clock_hand;
+static struct lock frame_lock;
+
+/* Fault-around and read-ahead.
+ *
+ * A fault on a page whose contents come from a file also brings
+ * in the pages after it, up to the thread's read-ahead window,
+ * so that a program reading its executable or a mapped file
+ * front to back takes one fault per window instead of one per
+ * page.  The window starts at FAULT_AROUND_PAGES.  When the next
+ * fault lands just past the pages read ahead, the access pattern
+ * is sequential and the window doubles, up to READAHEAD_MAX;
+ * any other fault shrinks it back.  Pages are read ahead only
+ * into free frames, never by evicting others. */
+#define FAULT_AROUND_PAGES 4
+#define READAHEAD_MAX 32
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
@@ -15,7 +46,13 @@ vm_init (void) {
 #endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
-	/* TODO: Your code goes here. */
+	vm_page_cache = kmem_cache_create ("page", sizeof (struct page), NULL);
+	vm_frame_cache = kmem_cache_create ("frame", sizeof (struct frame), NULL);
+	if (vm_page_cache == NULL || vm_frame_cache == NULL)
+		PANIC ("vm cache creation failed");
+	list_init (&frame_table);
+	clock_hand = list_end (&frame_table);
+	lock_init (&frame_lock);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -33,9 +70,16 @@ page_get_type (struct page *page) {
 }
 
 /* Helpers */
-static struct frame *vm_get_victim (void);
+static struct frame *vm_get_victim (struct thread *owner, bool anon_only);
 static bool vm_do_claim_page (struct page *page);
-static struct frame *vm_evict_frame (void);
+static struct frame *vm_evict_frame (struct thread *owner);
+static void vm_free_frame (struct frame *frame);
+static void frame_unshare (struct page *page);
+static bool vm_handle_wp (struct page *page);
+static bool vm_claim_frame (struct page *page, struct frame *frame);
+static void vm_fault_around (struct supplemental_page_table *spt,
+		struct page *page);
+static bool area_load (struct page *page, void *aux);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -50,141 +94,973 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
-		/* TODO: Create the page, fetch the initialier according to the VM type,
-		 * TODO: and then create "uninit" page struct by calling uninit_new. You
-		 * TODO: should modify the field after calling the uninit_new. */
+		bool (*initializer) (struct page *, enum vm_type, void *);
+		struct page *page;
 
-		/* TODO: Insert the page into the spt. */
+		switch (VM_TYPE (type)) {
+			case VM_ANON:
+				initializer = anon_initializer;
+				break;
+			case VM_FILE:
+				initializer = file_backed_initializer;
+				break;
+			default:
+				goto err;
+		}
+
+		page = kmem_cache_alloc (vm_page_cache);
+		if (page == NULL)
+			goto err;
+		uninit_new (page, upage, init, type, aux, initializer);
+		page->writable = writable;
+		page->owner = thread_current ();
+		if (!spt_insert_page (spt, page)) {
+			kmem_cache_free (vm_page_cache, page);
+			goto err;
+		}
+		return true;
 	}
 err:
 	return false;
 }
 
+/* Supplemental page table.
+ *
+ * The SPT has two levels.  The areas, kept in an array sorted by
+ * address, describe each region of the address space and where
+ * its contents come from; there are only a handful per process,
+ * so a binary search finds one quickly, and checking a new
+ * mapping for overlap or removing one works on whole ranges.
+ * The pages that have been used, and so have a struct page, are
+ * indexed by address in an open-addressing hash table, so the
+ * lookups done on every fault and system call buffer check take
+ * constant time.  spt_get_page() falls back from the page index
+ * to the areas, creating the struct page for an area's page when
+ * it is first used. */
+
+/* Returns a hash value for page E. */
+static uint64_t
+page_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct page *p = hash_entry (e, struct page, elem);
+	return hash_bytes (&p->va, sizeof p->va);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct page, elem)->va
+		< hash_entry (b, struct page, elem)->va;
+}
+
 /* Find VA from spt and return page. On error, return NULL. */
 struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function. */
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	struct page key;
+	struct hash_elem *e;
+
+	key.va = pg_round_down (va);
+	e = ohash_find (&spt->pages, &key.elem);
+	return e != NULL ? hash_entry (e, struct page, elem) : NULL;
+}
+
+/* Returns the page at VA in SPT, creating it if VA lies in one of
+ * SPT's areas and has not been used yet.  Returns NULL if VA is
+ * not in SPT or memory is not available. */
+struct page *
+spt_get_page (struct supplemental_page_table *spt, void *va) {
+	struct page *page = spt_find_page (spt, va);
+	struct vm_area *area;
+	enum vm_type type;
+	size_t ofs;
+
+	if (page != NULL)
+		return page;
+	area = vm_area_find (spt, va);
+	if (area == NULL)
+		return NULL;
 
-	return page;
+	/* Executable pages with file contents are read ahead; mapped
+	 * files are left to load on demand (see vm_fault_around()). */
+	va = pg_round_down (va);
+	ofs = (uint8_t *) va - area->start;
+	type = area->type;
+	if (VM_TYPE (type) == VM_ANON && area->file != NULL
+			&& ofs < area->read_bytes)
+		type |= VM_FILE_CONTENTS;
+	if (!vm_alloc_page_with_initializer (type, va, area->writable,
+				area_load, area))
+		return NULL;
+	return spt_find_page (spt, va);
 }
 
 /* Insert PAGE into spt with validation. */
 bool
-spt_insert_page (struct supplemental_page_table *spt UNUSED,
-		struct page *page UNUSED) {
-	int succ = false;
-	/* TODO: Fill this function. */
-
-	return succ;
+spt_insert_page (struct supplemental_page_table *spt,
+		struct page *page) {
+	return ohash_insert (&spt->pages, &page->elem) == NULL;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	ohash_delete (&spt->pages, &page->elem);
 	vm_dealloc_page (page);
+}
+
+/* Loads PAGE, which belongs to AUX, a struct vm_area, reading
+ * from the area's file if it has one and zeroing the rest. */
+static bool
+area_load (struct page *page, void *aux) {
+	struct vm_area *area = aux;
+	uint8_t *kva = page->frame->kva;
+	size_t ofs = (uint8_t *) page->va - area->start;
+	size_t read_bytes = 0;
+
+	if (area->file != NULL && ofs < area->read_bytes) {
+		read_bytes = area->read_bytes - ofs;
+		if (read_bytes > PGSIZE)
+			read_bytes = PGSIZE;
+		if (file_read_at (area->file, kva, read_bytes, area->ofs + ofs)
+				!= (off_t) read_bytes)
+			return false;
+	}
+	memset (kva + read_bytes, 0, PGSIZE - read_bytes);
 	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Returns the index of the first area in SPT that ends above VA,
+ * which is the area containing VA if any area does. */
+static size_t
+area_index (struct supplemental_page_table *spt, const void *va) {
+	size_t lo = 0, hi = spt->area_cnt;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if ((const uint8_t *) va < spt->areas[mid]->end)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/* Returns the area of SPT that contains VA, or NULL if none does. */
+struct vm_area *
+vm_area_find (struct supplemental_page_table *spt, const void *va) {
+	size_t i = area_index (spt, va);
+
+	if (i < spt->area_cnt && spt->areas[i]->start <= (const uint8_t *) va)
+		return spt->areas[i];
+	return NULL;
+}
+
+/* Returns true if any of the SIZE bytes at START lie in an area of
+ * SPT. */
+bool
+vm_area_overlaps (struct supplemental_page_table *spt,
+		const void *start, size_t size) {
+	size_t i = area_index (spt, start);
+
+	return i < spt->area_cnt
+		&& spt->areas[i]->start < (const uint8_t *) start + size;
+}
+
+/* Inserts AREA, which overlaps no other area, into SPT's array.
+ * Returns false if memory is not available. */
+static bool
+area_insert (struct supplemental_page_table *spt, struct vm_area *area) {
+	size_t i;
+
+	if (spt->area_cnt == spt->area_cap) {
+		size_t cap = spt->area_cap > 0 ? spt->area_cap * 2 : 8;
+		struct vm_area **areas = realloc (spt->areas, cap * sizeof *areas);
+		if (areas == NULL)
+			return false;
+		spt->areas = areas;
+		spt->area_cap = cap;
+	}
+
+	i = area_index (spt, area->start);
+	memmove (spt->areas + i + 1, spt->areas + i,
+			(spt->area_cnt - i) * sizeof *spt->areas);
+	spt->areas[i] = area;
+	spt->area_cnt++;
+	return true;
+}
+
+/* Frees AREA, closing its file. */
+static void
+area_free (struct vm_area *area) {
+	if (area->file != NULL)
+		file_close (area->file);
+	free (area);
+}
+
+/* Adds to SPT an area of SIZE bytes at START, a page boundary,
+ * whose pages have type TYPE and are WRITABLE.  The first
+ * READ_BYTES bytes come from FILE starting at offset OFS, and the
+ * rest are zeroed; FILE may be null if READ_BYTES is 0.  The area
+ * keeps its own reference to FILE.  Returns false if the area
+ * would overlap another or memory is not available. */
+bool
+vm_area_map (struct supplemental_page_table *spt, void *start,
+		size_t size, bool writable, enum vm_type type, struct file *file,
+		off_t ofs, size_t read_bytes) {
+	struct vm_area *area;
+
+	ASSERT (pg_ofs (start) == 0);
+	ASSERT (read_bytes <= size);
+	ASSERT (file != NULL || read_bytes == 0);
+
+	if (size == 0 || !is_user_vaddr ((uint8_t *) start + size - 1)
+			|| (uint8_t *) start + size < (uint8_t *) start
+			|| vm_area_overlaps (spt, start, size))
+		return false;
+
+	area = malloc (sizeof *area);
+	if (area == NULL)
+		return false;
+	area->start = start;
+	area->end = (uint8_t *) start + ROUND_UP (size, PGSIZE);
+	area->type = type;
+	area->writable = writable;
+	area->file = NULL;
+	area->ofs = ofs;
+	area->read_bytes = read_bytes;
+	if ((file != NULL && (area->file = file_reopen (file)) == NULL)
+			|| !area_insert (spt, area)) {
+		area_free (area);
+		return false;
+	}
+	return true;
+}
+
+/* Removes the area of SPT that begins at START, along with all of
+ * its pages.  Does nothing if no area begins at START. */
+void
+vm_area_unmap (struct supplemental_page_table *spt, void *start) {
+	size_t i = area_index (spt, start);
+	struct vm_area *area;
+	uint8_t *va;
+
+	if (i >= spt->area_cnt || spt->areas[i]->start != start)
+		return;
+	area = spt->areas[i];
+
+	for (va = area->start; va < area->end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+		if (page != NULL)
+			spt_remove_page (spt, page);
+	}
+
+	memmove (spt->areas + i, spt->areas + i + 1,
+			(spt->area_cnt - i - 1) * sizeof *spt->areas);
+	spt->area_cnt--;
+	area_free (area);
+}
+
+/* Advances the clock hand and returns the frame it passed. The
+ * frame table must not be empty. */
+static struct frame *
+clock_next (void) {
+	struct frame *f;
+
+	if (clock_hand == list_end (&frame_table))
+		clock_hand = list_begin (&frame_table);
+	f = list_entry (clock_hand, struct frame, elem);
+	clock_hand = list_next (clock_hand);
+	return f;
+}
+
+/* Returns the page after PAGE among those that map FRAME, starting
+ * from FRAME's page if PAGE is null, or NULL after the last. */
+static struct page *
+frame_next_page (struct frame *frame, struct page *page) {
+	struct list_elem *e;
+
+	if (page == NULL)
+		return frame->page;
+	e = page == frame->page ? list_begin (&frame->sharers)
+		: list_next (&page->share_elem);
+	return e != list_end (&frame->sharers)
+		? list_entry (e, struct page, share_elem) : NULL;
+}
+
+/* Iterates PAGE over every page that maps FRAME. */
+#define frame_for_each_page(page, frame) \
+	for ((page) = frame_next_page ((frame), NULL); (page) != NULL; \
+			(page) = frame_next_page ((frame), (page)))
+
+/* Returns true if TEST, which is pml4_is_accessed() or
+ * pml4_is_dirty(), holds for any page that maps FRAME. */
+static bool
+frame_test (struct frame *frame, bool (*test) (uint64_t *, const void *)) {
+	struct page *page;
+
+	frame_for_each_page (page, frame)
+		if (test (page->owner->pml4, page->va))
+			return true;
+	return false;
+}
+
+/* Returns true if OWNER has a page that maps FRAME. */
+static bool
+frame_mapped_by (struct frame *frame, struct thread *owner) {
+	struct page *page;
+
+	frame_for_each_page (page, frame)
+		if (page->owner == owner)
+			return true;
+	return false;
+}
+
+/* Returns true if a process with a page that maps FRAME holds no
+ * more than its reservation. */
+static bool
+frame_reserved (struct frame *frame) {
+	struct page *page;
+
+	frame_for_each_page (page, frame)
+		if (palloc_within_reserve (&page->owner->uquota))
+			return true;
+	return false;
+}
+
+/* Get the struct frame, that will be evicted.
+ *
+ * Chooses by the clock (second chance) algorithm, skipping pinned
+ * frames and, if OWNER is nonnull, frames that none of OWNER's
+ * pages map, and removes the victim from the frame table.  If
+ * OWNER is null, frames mapped by processes that hold no more
+ * than their reservation are skipped too, since their pages are
+ * set aside for them.  A frame that fork() shared counts as
+ * accessed or dirty if any of its pages is, and is only taken if
+ * its pages are anonymous, so that they can share a swap slot.
+ * Frame_lock must be held.  Returns NULL if every candidate is
+ * pinned.
+ *
+ * The hand sweeps the table up to four times.  On even sweeps it
+ * takes the first page that has been neither accessed nor written
+ * since its accessed bit was last cleared, and changes nothing
+ * else.  On odd sweeps it takes the first page that has not been
+ * accessed, dirty or not, clearing the accessed bit of each page
+ * it passes over.  Clean pages, which cost nothing to evict, are
+ * thus preferred to dirty ones, and all recently used pages get
+ * a second chance before any of them goes.
+ *
+ * If ANON_ONLY is true, only anonymous pages that have not been
+ * accessed are considered, in a single sweep that changes no
+ * accessed bits; this is how vm_evict_frame() finds companions
+ * for a victim it has already chosen. */
 static struct frame *
-vm_get_victim (void) {
+vm_get_victim (struct thread *owner, bool anon_only) {
 	struct frame *victim = NULL;
-	 /* TODO: The policy for eviction is up to you. */
+	size_t cnt = list_size (&frame_table);
+	size_t i;
+	int sweep;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
 
+	for (sweep = anon_only ? 1 : 0; sweep < (anon_only ? 2 : 4)
+			&& victim == NULL; sweep++)
+		for (i = 0; i < cnt && victim == NULL; i++) {
+			struct frame *f = clock_next ();
+			struct page *page;
+			bool accessed;
+
+			if (f->pin_cnt > 0
+					|| (owner != NULL && !frame_mapped_by (f, owner)))
+				continue;
+			if (owner == NULL && frame_reserved (f))
+				continue;
+			if ((anon_only || f->holders > 1)
+					&& page_get_type (f->page) != VM_ANON)
+				continue;
+			accessed = frame_test (f, pml4_is_accessed);
+			if (!accessed
+					&& (sweep % 2 == 1 || !frame_test (f, pml4_is_dirty)))
+				victim = f;
+			else if (accessed && sweep % 2 == 1 && !anon_only)
+				frame_for_each_page (page, f)
+					pml4_set_accessed (page->owner->pml4, page->va, false);
+		}
+
+	if (victim != NULL)
+		list_remove (&victim->elem);
 	return victim;
 }
 
+/* Unmaps every page in VICTIM, which has been taken out of the
+ * frame table, and returns whether its page was writable.  The
+ * pages of a shared frame are all mapped read-only. */
+static bool
+unmap_victim (struct frame *victim) {
+	uint64_t *pml4 = victim->page->owner->pml4;
+	void *va = victim->page->va;
+	bool writable = is_writable (pml4e_walk (pml4, (uint64_t) va, false));
+	struct page *page;
+
+	frame_for_each_page (page, victim)
+		pml4_clear_page (page->owner->pml4, page->va);
+	return writable;
+}
+
+/* Undoes unmap_victim(), mapping VICTIM's page again with
+ * WRITABLE, and its other pages read-only, and putting VICTIM
+ * back in the frame table. */
+static void
+restore_victim (struct frame *victim, bool writable) {
+	struct page *page;
+
+	frame_for_each_page (page, victim)
+		pml4_set_page (page->owner->pml4, page->va, victim->kva,
+				page == victim->page && writable);
+	list_insert (clock_hand, &victim->elem);
+}
+
+/* Detaches VICTIM, whose page has been swapped out, from its
+ * pages, which all take the page's swap slot, and moves the
+ * frame's charge to the running thread. */
+static void
+release_victim (struct frame *victim) {
+	while (!list_empty (&victim->sharers)) {
+		struct page *page = list_entry (list_pop_front (&victim->sharers),
+				struct page, share_elem);
+		anon_swap_share (page, victim->page);
+		page->frame = NULL;
+		palloc_drop_share (victim->kva, &page->owner->uquota);
+	}
+	victim->holders = 0;
+	victim->page->frame = NULL;
+	palloc_take_charge (&victim->page->owner->uquota);
+	victim->page = NULL;
+}
+
 /* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
+ * Return NULL on error.
+ *
+ * If OWNER is nonnull, only OWNER's pages are considered.  The
+ * page is unmapped before it is swapped out, so that its process
+ * cannot change it meanwhile, and mapped again if swapping out
+ * fails.  The frame's charge moves to the running thread.
+ *
+ * Writing one page to swap at a time costs a seek per page.  So
+ * if the victim is anonymous, up to SWAP_BATCH - 1 other idle
+ * anonymous pages are evicted along with it and written in a
+ * single pass by anon_swap_out_batch().  Only the first frame is
+ * returned; the others go back to the page allocator, where the
+ * faults that follow will find them without evicting anything. */
 static struct frame *
-vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
+vm_evict_frame (struct thread *owner) {
+	struct frame *victims[SWAP_BATCH];
+	struct page *pages[SWAP_BATCH];
+	bool writable[SWAP_BATCH];
+	size_t cnt, i;
 
-	return NULL;
+	lock_acquire (&frame_lock);
+	victims[0] = vm_get_victim (owner, false);
+	if (victims[0] == NULL) {
+		lock_release (&frame_lock);
+		return NULL;
+	}
+	cnt = 1;
+	if (page_get_type (victims[0]->page) == VM_ANON)
+		while (cnt < SWAP_BATCH
+				&& (victims[cnt] = vm_get_victim (owner, true)) != NULL)
+			cnt++;
+
+	for (i = 0; i < cnt; i++) {
+		pages[i] = victims[i]->page;
+		writable[i] = unmap_victim (victims[i]);
+	}
+
+	if (cnt > 1 && !anon_swap_out_batch (pages, cnt)) {
+		/* Not enough swap slots for everyone: keep the extras and
+		 * try the first victim alone. */
+		for (i = 1; i < cnt; i++)
+			restore_victim (victims[i], writable[i]);
+		cnt = 1;
+	}
+	if (cnt == 1 && !swap_out (pages[0])) {
+		restore_victim (victims[0], writable[0]);
+		lock_release (&frame_lock);
+		return NULL;
+	}
+
+	for (i = 0; i < cnt; i++)
+		release_victim (victims[i]);
+	for (i = 1; i < cnt; i++) {
+		palloc_free_page (victims[i]->kva);
+		kmem_cache_free (vm_frame_cache, victims[i]);
+	}
+	lock_release (&frame_lock);
+	return victims[0];
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * space.
+ *
+ * A process at its user page quota evicts one of its own pages
+ * instead.  Returns NULL if no frame can be freed, because every
+ * frame it might evict is pinned, or if MAY_EVICT is false and
+ * there is no free frame. */
 static struct frame *
-vm_get_frame (void) {
-	struct frame *frame = NULL;
-	/* TODO: Fill this function. */
+vm_get_frame (bool may_evict) {
+	struct frame *frame;
+	void *kva;
 
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+	kva = palloc_get_page (PAL_USER);
+	if (kva == NULL) {
+		if (!may_evict)
+			return NULL;
+		return vm_evict_frame (palloc_over_quota () ? thread_current () : NULL);
+	}
+
+	frame = kmem_cache_alloc (vm_frame_cache);
+	if (frame == NULL)
+		PANIC ("out of frame structures");
+	frame->kva = kva;
+	frame->page = NULL;
+	list_init (&frame->sharers);
+	frame->holders = 0;
+	frame->pin_cnt = 0;
 	return frame;
 }
 
+/* Unmaps FRAME's page, takes FRAME out of the frame table, and
+ * frees it.  FRAME must not be shared.  Frame_lock must be held. */
+static void
+vm_free_frame (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	ASSERT (frame->holders <= 1);
+
+	if (clock_hand == &frame->elem)
+		clock_hand = list_next (clock_hand);
+	list_remove (&frame->elem);
+	pml4_clear_page (frame->page->owner->pml4, frame->page->va);
+	frame->page->frame = NULL;
+	palloc_free_page (frame->kva);
+	kmem_cache_free (vm_frame_cache, frame);
+}
+
+/* Takes PAGE, a page of the running thread, off its frame, which
+ * other pages share, unmapping it and giving up the thread's
+ * share of the frame.  Frame_lock must be held. */
+static void
+frame_unshare (struct page *page) {
+	struct frame *frame = page->frame;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	ASSERT (frame->holders > 1);
+	ASSERT (page->owner == thread_current ());
+
+	if (page == frame->page)
+		frame->page = list_entry (list_pop_front (&frame->sharers),
+				struct page, share_elem);
+	else
+		list_remove (&page->share_elem);
+	frame->holders--;
+	pml4_clear_page (page->owner->pml4, page->va);
+	page->frame = NULL;
+
+	/* Frees nothing but the share, since other holders remain. */
+	palloc_free_page (frame->kva);
+}
+
+/* Pins the frame of each page of the SIZE bytes at BUFFER, first
+ * bringing it in if it is not resident, so that the pages stay
+ * in memory while the kernel reads them for I/O, or writes them
+ * if WRITE is true.  Pages not in the supplemental page table are
+ * left to the page fault handler.  Undo with vm_unpin_buffer().
+ * Returns false, with nothing left pinned, if some page could not
+ * be brought in or given a frame of its own. */
+bool
+vm_pin_buffer (const void *buffer, size_t size, bool write) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *va;
+
+	for (va = pg_round_down (buffer); va < (uint8_t *) buffer + size;
+			va += PGSIZE) {
+		struct page *page = spt_get_page (spt, va);
+		if (page == NULL)
+			continue;
+
+		/* A kernel write to a page on a shared frame would move
+		 * the page to a frame of its own and leave the pin behind,
+		 * so the page moves first.  Reading leaves it shared. */
+		if (write && page->writable && !vm_handle_wp (page))
+			goto fail;
+
+		lock_acquire (&frame_lock);
+		while (page->frame == NULL) {
+			lock_release (&frame_lock);
+			if (!vm_do_claim_page (page))
+				goto fail;
+			lock_acquire (&frame_lock);
+		}
+		page->frame->pin_cnt++;
+		lock_release (&frame_lock);
+	}
+	return true;
+
+fail:
+	/* Every page before VA was pinned. */
+	if (va > (uint8_t *) buffer)
+		vm_unpin_buffer (buffer, va - (uint8_t *) buffer);
+	return false;
+}
+
+/* Unpins the frames pinned by vm_pin_buffer() for BUFFER and SIZE. */
+void
+vm_unpin_buffer (const void *buffer, size_t size) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *va;
+
+	lock_acquire (&frame_lock);
+	for (va = pg_round_down (buffer); va < (uint8_t *) buffer + size;
+			va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+		if (page != NULL && page->frame != NULL && page->frame->pin_cnt > 0)
+			page->frame->pin_cnt--;
+	}
+	lock_release (&frame_lock);
+}
+
 /* Growing the stack. */
 static void
 vm_stack_growth (void *addr UNUSED) {
 }
 
-/* Handle the fault on write_protected page */
+/* Handle the fault on write_protected page
+ *
+ * PAGE is writable but mapped read-only, because fork() shared
+ * its frame (see vm_share_frame()).  If other pages still share
+ * the frame, PAGE gets a copy of its own; otherwise it becomes
+ * writable in place.  Does nothing if PAGE is not resident.
+ * Returns false if no frame is available for the copy. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	uint64_t *pml4 = page->owner->pml4;
+	struct frame *frame, *copy;
+	bool success = true;
+
+	lock_acquire (&frame_lock);
+	frame = page->frame;
+	if (frame != NULL && frame->holders > 1) {
+		/* Pin the shared frame so that it stays put while we
+		 * copy it, even if its other holders let it go. */
+		frame->pin_cnt++;
+		lock_release (&frame_lock);
+		copy = vm_get_frame (true);
+		if (copy != NULL)
+			page_copy (copy->kva, frame->kva);
+		lock_acquire (&frame_lock);
+		frame->pin_cnt--;
+
+		if (copy == NULL) {
+			lock_release (&frame_lock);
+			return false;
+		}
+		if (frame->holders > 1) {
+			frame_unshare (page);
+			copy->page = page;
+			copy->holders = 1;
+			page->frame = copy;
+			list_insert (clock_hand, &copy->elem);
+			success = pml4_set_page (pml4, page->va, copy->kva, true);
+			lock_release (&frame_lock);
+			return success;
+		}
+
+		/* The other holders left while we copied. */
+		palloc_free_page (copy->kva);
+		kmem_cache_free (vm_frame_cache, copy);
+	}
+	if (frame != NULL)
+		pml4_set_writable (pml4, page->va, true);
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Returns true if PAGE is not resident and its contents come
+ * from a file, so that it is worth reading ahead. */
+static bool
+is_readahead_page (struct page *page) {
+	if (page->frame != NULL)
+		return false;
+	if (page->operations->type == VM_UNINIT)
+		return (page->uninit.type & VM_FILE_CONTENTS) != 0;
+	return page_get_type (page) == VM_FILE;
+}
+
+/* Brings in the pages after PAGE, which was just faulted in from
+ * a file, as far as SPT's read-ahead window reaches, and adjusts
+ * the window for the next fault.  Stops early at a page that is
+ * not in SPT or not backed by a file, or when no frame is free.
+ * Pages already resident count against the window but are
+ * otherwise skipped. */
+static void
+vm_fault_around (struct supplemental_page_table *spt, struct page *page) {
+	uint8_t *va = (uint8_t *) page->va + PGSIZE;
+	size_t i;
+
+	if (page->va == spt->ra_next)
+		spt->ra_window = spt->ra_window * 2 > READAHEAD_MAX
+			? READAHEAD_MAX : spt->ra_window * 2;
+	else
+		spt->ra_window = FAULT_AROUND_PAGES;
+
+	for (i = 0; i < spt->ra_window && is_user_vaddr (va);
+			i++, va += PGSIZE) {
+		struct page *next = spt_get_page (spt, va);
+		struct frame *frame;
+
+		if (next == NULL)
+			break;
+		if (next->frame != NULL)
+			continue;
+		if (!is_readahead_page (next))
+			break;
+		frame = vm_get_frame (false);
+		if (frame == NULL || !vm_claim_frame (next, frame))
+			break;
+	}
+	spt->ra_next = va;
 }
 
 /* Return true on success */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
-		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
-	struct page *page = NULL;
-	/* TODO: Validate the fault */
-	/* TODO: Your code goes here */
+vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr,
+		bool user UNUSED, bool write, bool not_present) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *page;
+	bool readahead;
 
-	return vm_do_claim_page (page);
+	if (addr == NULL || !is_user_vaddr (addr))
+		return false;
+	page = spt_get_page (spt, addr);
+	if (page == NULL)
+		return false;
+	if (!not_present)
+		return write && page->writable && vm_handle_wp (page);
+	if (write && !page->writable)
+		return false;
+
+	readahead = is_readahead_page (page);
+	if (!vm_do_claim_page (page))
+		return false;
+	if (readahead)
+		vm_fault_around (spt, page);
+	return true;
 }
 
-/* Free the page.
- * DO NOT MODIFY THIS FUNCTION. */
+/* Free the page, which must have come from vm_page_cache.
+ *
+ * The page leaves its frame before it is destroyed, since until
+ * then an eviction may swap it out and give it a slot. */
 void
 vm_dealloc_page (struct page *page) {
+	lock_acquire (&frame_lock);
+	if (page->frame != NULL && page->frame->holders > 1)
+		frame_unshare (page);
+	else if (page->frame != NULL)
+		vm_free_frame (page->frame);
+	lock_release (&frame_lock);
 	destroy (page);
-	free (page);
+	kmem_cache_free (vm_page_cache, page);
 }
 
 /* Claim the page that allocate on VA. */
 bool
-vm_claim_page (void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function */
+vm_claim_page (void *va) {
+	struct page *page = spt_get_page (&thread_current ()->spt, va);
 
-	return vm_do_claim_page (page);
+	if (page == NULL)
+		return false;
+	return page->frame != NULL || vm_do_claim_page (page);
 }
 
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+	struct frame *frame = vm_get_frame (true);
 
-	/* Set links */
+	return frame != NULL && vm_claim_frame (page, frame);
+}
+
+/* Brings PAGE into FRAME, which vm_get_frame() returned, and maps
+ * it.  Frees FRAME on failure. */
+static bool
+vm_claim_frame (struct page *page, struct frame *frame) {
+	struct thread *t = thread_current ();
+
+	/* Set links.  The frame stays pinned until the page is in it
+	 * and mapped. */
 	frame->page = page;
+	frame->holders = 1;
+	frame->pin_cnt = 1;
+	lock_acquire (&frame_lock);
 	page->frame = frame;
+	list_insert (clock_hand, &frame->elem);
+	lock_release (&frame_lock);
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	if (!swap_in (page, frame->kva)
+			|| !pml4_set_page (t->pml4, page->va, frame->kva, page->writable)) {
+		lock_acquire (&frame_lock);
+		vm_free_frame (frame);
+		lock_release (&frame_lock);
+		return false;
+	}
 
-	return swap_in (page, frame->kva);
+	lock_acquire (&frame_lock);
+	frame->pin_cnt--;
+	lock_release (&frame_lock);
+	return true;
 }
 
 /* Initialize new supplemental page table */
-void
-supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
+bool
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	memset (spt, 0, sizeof *spt);
+	spt->ra_window = FAULT_AROUND_PAGES;
+	if (!ohash_init (&spt->pages, page_hash, page_less, NULL)) {
+		memset (spt, 0, sizeof *spt);
+		return false;
+	}
+	return true;
+}
+
+/* Initializer for a page that fork() copies from AUX, the
+ * parent's page, when it is swapped out or its frame cannot be
+ * shared. */
+static bool
+copy_page (struct page *page, void *aux) {
+	struct page *src = aux;
+	struct frame *frame;
+
+	/* Pin the parent's frame so that it is not evicted while we
+	 * copy from it.  A page that is out stays out, since only its
+	 * own process, which is waiting for us, brings it back in. */
+	lock_acquire (&frame_lock);
+	frame = src->frame;
+	if (frame != NULL)
+		frame->pin_cnt++;
+	lock_release (&frame_lock);
+
+	if (frame == NULL)
+		return page_get_type (src) == VM_ANON
+			&& anon_swap_copy (src, page->frame->kva);
+
+	page_copy (page->frame->kva, frame->kva);
+	lock_acquire (&frame_lock);
+	frame->pin_cnt--;
+	lock_release (&frame_lock);
+	return true;
 }
 
-/* Copy supplemental page table from src to dst */
+/* Maps the frame of SRC, a page of the parent process, at the
+ * same address in the running thread, as a new anonymous page
+ * that shares the frame.  The frame becomes read-only in both
+ * page tables, and the first write through either copies it;
+ * see vm_handle_wp().  Returns false, changing nothing, if SRC is
+ * not resident or its frame cannot be shared. */
+static bool
+vm_share_frame (struct page *src) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct frame *frame;
+	struct page *page;
+	bool success;
+
+	if (!vm_alloc_page (VM_ANON, src->va, src->writable))
+		return false;
+	page = spt_find_page (spt, src->va);
+
+	lock_acquire (&frame_lock);
+	frame = src->frame;
+	success = frame != NULL && swap_in (page, frame->kva)
+		&& palloc_share_page (frame->kva);
+	if (success) {
+		page->frame = frame;
+		list_push_back (&frame->sharers, &page->share_elem);
+		frame->holders++;
+		pml4_set_writable (src->owner->pml4, src->va, false);
+		success = pml4_set_page (page->owner->pml4, page->va, frame->kva,
+				false);
+	}
+	lock_release (&frame_lock);
+
+	if (!success)
+		spt_remove_page (spt, page);
+	return success;
+}
+
+/* Copy supplemental page table from src to dst
+ *
+ * Copies SRC's areas whole.  Pages of an area that the parent
+ * has not touched need nothing more, since the child creates
+ * them from its copy of the area in the same way, and neither
+ * do pages the parent has let go that its area can bring back.
+ * Every resident page is shared with the child, copy-on-write.
+ * Swapped-out anonymous pages, and pages whose frame cannot be
+ * shared, are copied. */
 bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
-		struct supplemental_page_table *src UNUSED) {
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	struct ohash_iterator i;
+	size_t j;
+
+	for (j = 0; j < src->area_cnt; j++) {
+		struct vm_area *a = src->areas[j];
+		if (!vm_area_map (dst, a->start, a->end - a->start, a->writable,
+					a->type, a->file, a->ofs, a->read_bytes))
+			return false;
+	}
+
+	ohash_first (&i, &src->pages);
+	while (ohash_next (&i)) {
+		struct page *page = hash_entry (ohash_cur (&i), struct page, elem);
+
+		if (page->operations->type == VM_UNINIT) {
+			if (page->uninit.init == area_load)
+				continue;
+			if (page->uninit.aux != NULL)
+				return false;
+			if (!vm_alloc_page_with_initializer (page->uninit.type, page->va,
+						page->writable, page->uninit.init, NULL))
+				return false;
+			continue;
+		}
+		if (vm_share_frame (page))
+			continue;
+		if (page->frame == NULL && page_get_type (page) != VM_ANON)
+			continue;
+		if (!vm_alloc_page_with_initializer (VM_ANON, page->va,
+					page->writable, copy_page, page)
+				|| !vm_claim_page (page->va))
+			return false;
+	}
+	return true;
 }
 
-/* Free the resource hold by the supplemental page table */
+/* Frees page E of a supplemental page table being destroyed. */
+static void
+spt_free_page (struct hash_elem *e, void *aux UNUSED) {
+	vm_dealloc_page (hash_entry (e, struct page, elem));
+}
+
+/* Free the resource hold by the supplemental page table
+ *
+ * Leaves SPT empty, ready for supplemental_page_table_init(), and
+ * safe to kill again. */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
-	/* TODO: Destroy all the supplemental_page_table hold by thread and
-	 * TODO: writeback all the modified contents to the storage. */
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
+	size_t i;
+
+	ohash_destroy (&spt->pages, spt_free_page);
+	for (i = 0; i < spt->area_cnt; i++)
+		area_free (spt->areas[i]);
+	free (spt->areas);
+	memset (spt, 0, sizeof *spt);
 }